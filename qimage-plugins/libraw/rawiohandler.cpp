@@ -38,6 +38,8 @@ public:
     ~RawIOHandlerPrivate();
 
     bool load(QIODevice *device);
+    QSize finalSize() const;
+    bool useThumbnail() const;
 
     LibRaw *raw;
     Datastream *stream;
@@ -80,6 +82,19 @@ bool RawIOHandlerPrivate::load(QIODevice *device)
     return true;
 }
 
+QSize RawIOHandlerPrivate::finalSize() const
+{
+    return scaledSize.isValid() ? scaledSize : defaultSize;
+}
+
+//目标尺寸小于内嵌缩略图时直接解码缩略图（8位），否则解码原始数据（16位）
+bool RawIOHandlerPrivate::useThumbnail() const
+{
+    const QSize size = finalSize();
+    return size.width() < raw->imgdata.thumbnail.twidth ||
+           size.height() < raw->imgdata.thumbnail.theight;
+}
+
 
 RawIOHandler::RawIOHandler():
     d(new RawIOHandlerPrivate(this))
@@ -118,18 +133,18 @@ bool RawIOHandler::read(QImage *image)
 {
     if (!d->load(device())) return false;
 
-    QSize finalSize = d->scaledSize.isValid() ?
-                      d->scaledSize : d->defaultSize;
+    QSize finalSize = d->finalSize();
 
     const libraw_data_t &imgdata = d->raw->imgdata;
     libraw_processed_image_t *output;
-    if (finalSize.width() < imgdata.thumbnail.twidth ||
-            finalSize.height() < imgdata.thumbnail.theight) {
+    if (d->useThumbnail()) {
         qDebug() << "Using thumbnail";
         d->raw->unpack_thumb();
         output = d->raw->dcraw_make_mem_thumb();
     } else {
         qDebug() << "Decoding raw data";
+        //按16位输出，缩放到显示尺寸后才转为8位
+        d->raw->imgdata.params.output_bps = 16;
         d->raw->unpack();
         d->raw->dcraw_process();
         output = d->raw->dcraw_make_mem_image();
@@ -150,6 +165,34 @@ bool RawIOHandler::read(QImage *image)
                 unscaled = unscaled.transformed(rotation);
             }
         }
+    } else if (output->bits == 16) {
+        const quint16 *data = reinterpret_cast<const quint16 *>(output->data);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        //原始数据没有alpha，用RGBX64，转为8位后为RGB32
+        unscaled = QImage(output->width, output->height, QImage::Format_RGBX64);
+        for (int y = 0; y < output->height; y++) {
+            quint16 *line = reinterpret_cast<quint16 *>(unscaled.scanLine(y));
+            for (int x = 0; x < output->width; x++, data += output->colors) {
+                line[x * 4] = data[0];
+                line[x * 4 + 1] = output->colors == 3 ? data[1] : data[0];
+                line[x * 4 + 2] = output->colors == 3 ? data[2] : data[0];
+                line[x * 4 + 3] = 0xffff;
+            }
+        }
+#else
+        //没有64位格式时取每个通道的高8位
+        unscaled = QImage(output->width, output->height, QImage::Format_ARGB32);
+        for (int y = 0; y < output->height; y++) {
+            QRgb *line = reinterpret_cast<QRgb *>(unscaled.scanLine(y));
+            for (int x = 0; x < output->width; x++, data += output->colors) {
+                if (output->colors == 3) {
+                    line[x] = qRgb(data[0] >> 8, data[1] >> 8, data[2] >> 8);
+                } else {
+                    line[x] = qRgb(data[0] >> 8, data[0] >> 8, data[0] >> 8);
+                }
+            }
+        }
+#endif
     } else {
         int numPixels = output->width * output->height;
         int colorSize = output->bits / 8;
@@ -197,7 +240,19 @@ QVariant RawIOHandler::option(ImageOption option) const
 {
     switch (option) {
     case ImageFormat:
-        return QImage::Format_RGB32;
+        //与read实际走的解码路径一致
+        if (!d->load(device())) {
+            return QImage::Format_Invalid;
+        }
+        if (d->useThumbnail()) {
+            return d->raw->imgdata.thumbnail.tformat == LIBRAW_THUMBNAIL_JPEG
+                   ? QImage::Format_RGB32 : QImage::Format_ARGB32;
+        }
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        return QImage::Format_RGBX64;
+#else
+        return QImage::Format_ARGB32;
+#endif
     case Size:
         d->load(device());
         return d->defaultSize;
@@ -18,11 +18,14 @@
 
 #include "controller/configsetter.h"
 #include "controller/globaleventfilter.h"
+#include "controller/rotationwriter.h"
 #include "controller/signalmanager.h"
 #include "controller/wallpapersetter.h"
 #include "controller/viewerthememanager.h"
+#include "utils/imageutils.h"
 #include "utils/snifferimageformat.h"
 #include "frame/mainwindow.h"
+#include "module/slideshow/sliderenderpool.h"
 
 #include <QDebug>
 #include <QTranslator>
@@ -42,6 +45,12 @@
 #endif
 namespace {
 
+const QString HDR_SETTING_GROUP = "HDR";
+const QString HDR_TONEMAPPING_KEY = "ToneMapping";
+const QString HDR_EXPOSURE_KEY = "Exposure";
+const QString ROTATION_SETTING_GROUP = "ROTATION";
+const QString ROTATION_ORIENTATION_TAG_KEY = "OrientationTag";
+
 }  // namespace
 
 //#define PIXMAP_LOAD //用于判断是否采用pixmap加载，qimage加载会有内存泄露
@@ -269,33 +278,34 @@ void ImageLoader::stopThread()
 //modify by heyi
 void ImageLoader::updateImageLoader(QStringList pathlist, bool bDirection,int rotateangle)
 {
+    //缩略图只有屏幕上的大小，直接旋转缓存中的像素。缓存中没有时按缩略图尺寸解码，
+    //此时旋转还没有写入文件，解码后同样需要旋转
+    QMatrix rotate;
+    if (bDirection) {
+        rotate.rotate(rotateangle);
+    } else {
+        rotate.rotate(0-rotateangle);
+    }
     for (QString path : pathlist) {
-        QMutexLocker locker(&dApp->getRwLock());
-//        dApp->getRwLock().lockForWrite();
-        QPixmap pixmap = m_parent->m_imagemap[path];
+        QPixmap pixmap;
+        {
+            QMutexLocker locker(&dApp->getRwLock());
+            pixmap = m_parent->m_imagemap.value(path);
+        }
         if (pixmap.isNull()) {
-            QImage image(path);
-            pixmap = QPixmap::fromImage(image);
-        } else {
-            QMatrix rotate;
-            if (bDirection) {
-                rotate.rotate(rotateangle);
-            } else {
-                rotate.rotate(0-rotateangle);
-            }
-
-            pixmap = pixmap.transformed(rotate, Qt::FastTransformation);
+            pixmap = QPixmap::fromImage(utils::image::loadScaledImage(path, QSize(IMAGE_HEIGHT_DEFAULT * 8, IMAGE_HEIGHT_DEFAULT)));
         }
+        pixmap = pixmap.transformed(rotate, Qt::FastTransformation);
 
-        //QImage image(path);
-        //QPixmap pixmap = QPixmap::fromImage(image);
+        QMutexLocker locker(&dApp->getRwLock());
         m_parent->m_imagemap[path] = pixmap.scaledToHeight(IMAGE_HEIGHT_DEFAULT,  Qt::FastTransformation);
-       // dApp->getRwLock().unlock();
     }
 }
 
 void ImageLoader::loadInterface(QString path)
 {
+    //幻灯片切换进行中时先让出CPU，避免切换掉帧
+    SlideRenderPool::instance()->yieldToTransition();
     /*lmh0724使用USE_UNIONIMAGE*/
 #ifdef USE_UNIONIMAGE
     QImage tImg;
@@ -304,8 +314,9 @@ void ImageLoader::loadInterface(QString path)
         qDebug() << errMsg;
     }
     /*lmh0728线程pixmap安全问题*/
+    //高位深图片缩放成缩略图后再转为8位
     QImage img=tImg.scaledToHeight(IMAGE_HEIGHT_DEFAULT,  Qt::SmoothTransformation);
-    QPixmap pixmap = QPixmap::fromImage(img);
+    QPixmap pixmap = QPixmap::fromImage(UnionImage_NameSpace::toDisplayImage(img));
 #else
     QImage tImg;
     QString format = DetectImageFormat(path);
@@ -384,7 +395,7 @@ void Application::loadInterface(QString path)
         qDebug() << errMsg;
     }
     QImage img=tImg.scaledToHeight(IMAGE_HEIGHT_DEFAULT,  Qt::FastTransformation);
-    QPixmap pixmap = QPixmap::fromImage(img);
+    QPixmap pixmap = QPixmap::fromImage(UnionImage_NameSpace::toDisplayImage(img));
 #else
     QImage tImg;
     QString format = DetectImageFormat(path);
@@ -519,6 +530,31 @@ void Application::initChildren()
     setter = ConfigSetter::instance();
     signalM = SignalManager::instance();
     wpSetter = WallpaperSetter::instance();
+    //在缩略图加载线程启动前创建，capacityAvailable在界面线程派发
+    SlideRenderPool::instance();
+#ifdef USE_UNIONIMAGE
+    //高位深图片的色调映射（Reinhard/Clip）和显示曝光（档）
+    auto applyHdrSettings = [ = ] {
+        const QString toneMapping = setter->value(HDR_SETTING_GROUP, HDR_TONEMAPPING_KEY, "Reinhard").toString();
+        UnionImage_NameSpace::setHdrDisplay(toneMapping.compare("Clip", Qt::CaseInsensitive) == 0
+                                            ? utils::image::ToneMapClip : utils::image::ToneMapReinhard,
+                                            setter->value(HDR_SETTING_GROUP, HDR_EXPOSURE_KEY, 0).toDouble());
+    };
+    //JPEG/TIFF旋转是否只改写EXIF方向标签
+    auto applyRotationSettings = [ = ] {
+        UnionImage_NameSpace::setRotateByOrientationTag(
+            setter->value(ROTATION_SETTING_GROUP, ROTATION_ORIENTATION_TAG_KEY, true).toBool());
+    };
+    applyHdrSettings();
+    applyRotationSettings();
+    connect(setter, &ConfigSetter::valueChanged, this, [ = ](const QString &group) {
+        if (group == HDR_SETTING_GROUP) {
+            applyHdrSettings();
+        } else if (group == ROTATION_SETTING_GROUP) {
+            applyRotationSettings();
+        }
+    });
+#endif
 }
 
 void Application::initI18n()
@@ -547,6 +583,7 @@ Application::~Application()
     }
 
     emit endApplication();
+    RotationWriter::instance()->waitForDone();
 }
 
 void Application::quitApp()
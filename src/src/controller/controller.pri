@@ -1,6 +1,7 @@
 HEADERS += \
     $$PWD/signalmanager.h \
     $$PWD/wallpapersetter.h \
+    $$PWD/rotationwriter.h \
     $$PWD/commandline.h \
     $$PWD/configsetter.h \
     $$PWD/globaleventfilter.h \
@@ -10,6 +11,7 @@ HEADERS += \
 SOURCES += \
     $$PWD/signalmanager.cpp \
     $$PWD/wallpapersetter.cpp \
+    $$PWD/rotationwriter.cpp \
     $$PWD/commandline.cpp \
     $$PWD/configsetter.cpp \
     $$PWD/globaleventfilter.cpp \
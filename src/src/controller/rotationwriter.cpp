@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "rotationwriter.h"
+#include "utils/imageutils.h"
+#ifdef USE_UNIONIMAGE
+#include "utils/unionimage.h"
+#endif
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QProgressDialog>
+#include <QtConcurrent>
+
+#include <cstdio>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+namespace {
+
+//写入时间超过该值才显示进度对话框
+const int FLUSH_PROGRESS_DELAY = 500;
+
+//把扩展属性（标签、安全上下文等）复制到替换用的临时文件，复制不了的属性跳过
+void copyXattrs(const QByteArray &from, const QByteArray &to)
+{
+    const ssize_t size = ::listxattr(from.constData(), nullptr, 0);
+    if (size <= 0)
+        return;
+    QByteArray names(int(size), '\0');
+    if (::listxattr(from.constData(), names.data(), size_t(names.size())) != size)
+        return;
+    for (const QByteArray &name : names.split('\0')) {
+        if (name.isEmpty())
+            continue;
+        const ssize_t length = ::getxattr(from.constData(), name.constData(), nullptr, 0);
+        if (length < 0)
+            continue;
+        QByteArray value(int(length), '\0');
+        if (::getxattr(from.constData(), name.constData(), value.data(), size_t(value.size())) == length) {
+            ::setxattr(to.constData(), name.constData(), value.constData(), size_t(value.size()), 0);
+        }
+    }
+}
+
+}  // namespace
+
+RotationWriter *RotationWriter::m_writer = nullptr;
+RotationWriter *RotationWriter::instance()
+{
+    if (! m_writer) {
+        m_writer = new RotationWriter();
+    }
+
+    return m_writer;
+}
+
+RotationWriter::RotationWriter(QObject *parent) : QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+void RotationWriter::enqueue(const QString &path, int angle)
+{
+    if (path.isEmpty() || angle % 90 != 0)
+        return;
+    QMutexLocker locker(&m_mutex);
+    const bool queued = m_pending.contains(path);
+    const int net = (m_pending.value(path) + angle) % 360;
+    if (net == 0) {
+        //转回了原方向，不需要写入
+        if (queued) {
+            m_pending.remove(path);
+            m_order.removeOne(path);
+            m_total--;
+            m_written.wakeAll();
+        }
+        return;
+    }
+    m_pending.insert(path, net);
+    if (!queued) {
+        m_order.append(path);
+        m_total++;
+    }
+    if (!m_running) {
+        m_running = true;
+        QtConcurrent::run(&m_pool, [this] { run(); });
+    }
+}
+
+void RotationWriter::waitForFile(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_pending.contains(path) || m_writing == path) {
+        m_written.wait(&m_mutex);
+    }
+}
+
+void RotationWriter::waitForDone()
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_running) {
+        m_written.wait(&m_mutex);
+    }
+}
+
+void RotationWriter::flush(QWidget *parent)
+{
+    if (isIdle())
+        return;
+
+    QProgressDialog dialog(tr("Saving rotated images..."), QString(), 0, 0, parent);
+    dialog.setWindowModality(Qt::ApplicationModal);
+    dialog.setMinimumDuration(FLUSH_PROGRESS_DELAY);
+    QEventLoop loop;
+    connect(this, &RotationWriter::progressChanged, &dialog, [&dialog](int done, int total) {
+        dialog.setMaximum(total);
+        dialog.setValue(done);
+    });
+    connect(this, &RotationWriter::finished, &loop, &QEventLoop::quit);
+    //连接之前已经写完时不会再收到finished
+    if (isIdle())
+        return;
+    loop.exec(QEventLoop::ExcludeUserInputEvents);
+}
+
+bool RotationWriter::isIdle() const
+{
+    QMutexLocker locker(&m_mutex);
+    return !m_running;
+}
+
+void RotationWriter::run()
+{
+    forever {
+        QMutexLocker locker(&m_mutex);
+        if (m_order.isEmpty()) {
+            m_running = false;
+            m_done = 0;
+            m_total = 0;
+            m_written.wakeAll();
+            locker.unlock();
+            emit finished();
+            return;
+        }
+        const QString path = m_order.takeFirst();
+        const int angle = m_pending.take(path);
+        m_writing = path;
+        locker.unlock();
+
+        if (!writeRotation(path, angle)) {
+            qWarning() << "rotate image failed:" << path;
+        }
+
+        locker.relock();
+        m_writing.clear();
+        const int done = ++m_done;
+        const int total = m_total;
+        m_written.wakeAll();
+        locker.unlock();
+        emit progressChanged(done, total);
+    }
+}
+
+bool RotationWriter::writeRotation(const QString &path, int angle)
+{
+    //符号链接替换它指向的文件，不把链接本身换成普通文件
+    const QString target = QFileInfo(path).canonicalFilePath();
+    if (target.isEmpty())
+        return false;
+#ifdef USE_UNIONIMAGE
+    //只改写方向标签时原地写一个字节，不需要复制整个文件
+    if (UnionImage_NameSpace::rotateImageFileByOrientationTag(angle, target))
+        return true;
+#endif
+
+    //临时文件与原文件同目录、同后缀，重命名不跨文件系统，格式识别也不受影响
+    const QFileInfo info(target);
+    const QString tempPath = info.absolutePath() + "/.rotate-"
+                             + QString::number(QCoreApplication::applicationPid()) + "-" + info.fileName();
+    QFile::remove(tempPath);
+    if (!QFile::copy(target, tempPath)) {
+        //目录不可写时退回原地旋转
+        return utils::image::rotate(target, angle);
+    }
+    if (!utils::image::rotate(tempPath, angle)) {
+        QFile::remove(tempPath);
+        return false;
+    }
+
+    //旋转本身可能替换临时文件，权限、属主和扩展属性在旋转之后再复制
+    const QByteArray tempName = QFile::encodeName(tempPath);
+    QFile::setPermissions(tempPath, info.permissions());
+    if (::chown(tempName.constData(), info.ownerId(), info.groupId()) != 0) {
+        //无法保留属主（他人的文件），退回原地旋转，不改变文件归属
+        QFile::remove(tempPath);
+        return utils::image::rotate(target, angle);
+    }
+    copyXattrs(QFile::encodeName(target), tempName);
+    if (::rename(tempName.constData(), QFile::encodeName(target).constData()) != 0) {
+        QFile::remove(tempPath);
+        return false;
+    }
+    return true;
+}
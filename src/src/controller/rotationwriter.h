@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ROTATIONWRITER_H
+#define ROTATIONWRITER_H
+
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+class QWidget;
+
+/**
+ * @brief The RotationWriter class
+ * 旋转结果的后台写入队列：同一文件多次旋转合并为一个净角度，
+ * 由一个后台线程依次写入，界面线程不等待编码。
+ * 只改写方向标签时原地写入，需要重新编码时写临时文件后原子替换原文件
+ */
+class RotationWriter : public QObject
+{
+    Q_OBJECT
+public:
+    static RotationWriter *instance();
+
+    /**
+     * @brief enqueue 加入一次旋转，角度为90的倍数，顺时针为正
+     */
+    void enqueue(const QString &path, int angle);
+    /**
+     * @brief waitForFile 等待该文件的旋转写入完成，之后需要读取、打印或改名本地文件时调用
+     */
+    void waitForFile(const QString &path);
+    /**
+     * @brief waitForDone 阻塞等待所有旋转写入完成
+     */
+    void waitForDone();
+    /**
+     * @brief flush 退出前写完所有旋转，耗时较长时显示进度对话框
+     */
+    void flush(QWidget *parent = nullptr);
+    bool isIdle() const;
+
+signals:
+    /**
+     * @brief progressChanged 本轮已写入的文件数和总数，在后台线程发出
+     */
+    void progressChanged(int done, int total);
+    void finished();
+
+private:
+    explicit RotationWriter(QObject *parent = nullptr);
+    void run();
+    static bool writeRotation(const QString &path, int angle);
+
+    static RotationWriter *m_writer;
+    mutable QMutex m_mutex;
+    QWaitCondition m_written;
+    //等待写入的净角度，m_order保持加入顺序
+    QHash<QString, int> m_pending;
+    QStringList m_order;
+    QString m_writing;
+    bool m_running = false;
+    int m_done = 0;
+    int m_total = 0;
+    //只用一个线程，同一文件的写入不会交错
+    QThreadPool m_pool;
+};
+
+#endif // ROTATIONWRITER_H
@@ -22,6 +22,7 @@
 #include "application.h"
 #include "controller/configsetter.h"
 #include "controller/dbusclient.h"
+#include "controller/rotationwriter.h"
 #include "mainwidget.h"
 //#include <QDebug>
 #include <dgiovolumemanager.h>
@@ -334,6 +335,8 @@ void MainWindow::closeEvent(QCloseEvent *event)
         m_sharememory.detach();
     emit dApp->signalM->hideExtensionPanel();
     emit dApp->endApplication();
+    //写完后台队列中的旋转再退出
+    RotationWriter::instance()->flush(this);
 }
 
 bool MainWindow::windowAtEdge()
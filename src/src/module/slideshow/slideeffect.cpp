@@ -15,21 +15,28 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "slideeffect.h"
+#include "slideregioncompositor.h"
+#include "sliderenderpool.h"
 #include "application.h"
 #include "controller/configsetter.h"
 #include "utils/imageutils.h"
 #include <QPainter>
 #include <QtCore/QTimerEvent>
-#include <malloc.h>
 #include <QDebug>
 
 namespace {
 
 const QString EFFECT_SETTING_GROUP = "SLIDESHOWEFFECT";
+//环形帧缓冲个数：两块可能仍被显示端引用，其余用于提前渲染
+const int FRAME_RING_SIZE = 4;
+const int FRAME_PRESENTED_HOLD = 2;
+//帧调度的定时间隔，接近屏幕刷新周期
+const int FRAME_TICK_MS = 16;
 
 } // namespace
 
 QHash<EffectId, std::function<SlideEffect*()> > SlideEffect::effects;
+QHash<EffectId, SlideEffect::EffectName> SlideEffect::effectNames;
 
 
 ThreadRenderFrame::ThreadRenderFrame()
@@ -51,41 +58,70 @@ ThreadRenderFrame::~ThreadRenderFrame()
 
 }
 
-void ThreadRenderFrame::stop()
+void ThreadRenderFrame::setData(SlideEffectThreadData &data)
 {
-    bstop = true;
+//    qDebug() << "ThreadRenderImage::setPage" << width << height;
+    //交换而不是复制，保证帧缓冲只被渲染线程引用，绘制时不会深拷贝
+    std::swap(m_data, data);
 }
 
-void ThreadRenderFrame::setData(SlideEffectThreadData &data)
+QImage ThreadRenderFrame::takeBuffer()
 {
-//    qDebug() << "ThreadRenderImage::setPage" << width << height;
-    m_data = data;
+    QImage image;
+    image.swap(m_data.mimage);
+    return image;
+}
+
+bool ThreadRenderFrame::isCancelled() const
+{
+    return m_data.cancel && m_data.cancel->loadAcquire();
 }
 
 void ThreadRenderFrame::run()
 {
-    if (bstop)
-        return;
-    SlideEffectThreadData mdata = m_data;
+    QImage image;
+    image.swap(m_data.mimage);
+    //已取消的帧不再渲染，缓冲照常交回效果回收
+    if (!isCancelled()) {
+        render(image);
+    }
+    //先释放对源图的引用，效果重置后源图可以立即释放
+    m_data.current_image = QImage();
+    m_data.next_image = QImage();
+    emit signal_RenderFinish(m_data.generation, m_data.num, image);
+    SlideRenderPool::instance()->taskFinished();
+}
+
+void ThreadRenderFrame::render(QImage &image)
+{
+    const SlideEffectThreadData &mdata = m_data;
 //    qDebug() << "-------renderFrame start num:" << mdata.num;
-    QImage image = mdata.mimage;
-    QPainter p(&image);
-    image.fill(Qt::transparent);
 
-    if (bstop){
-        return;
-    }
-    p.setClipRegion(mdata.current_region);
-    p.drawImage(QRect(0, 0, mdata.width, mdata.height), /**current_image*/mdata.current_image, mdata.current_rect);
+    //源图与帧等大时按区域逐行拷贝，否则回退到QPainter裁剪绘制
+    QPoint currentOffset;
+    QPoint nextOffset;
+    if (SlideRegionCompositor::sourceOffset(image, mdata.current_image, mdata.current_rect, &currentOffset)
+            && SlideRegionCompositor::sourceOffset(image, mdata.next_image, mdata.next_rect, &nextOffset)) {
+        SlideRegionCompositor::clear(image, QRegion(image.rect()) - mdata.current_region - mdata.next_region);
+        SlideRegionCompositor::composite(image, mdata.current_image, currentOffset, mdata.current_region);
+        if (isCancelled()) {
+            return;
+        }
+        SlideRegionCompositor::composite(image, mdata.next_image, nextOffset, mdata.next_region);
+    } else {
+        QPainter p(&image);
+        image.fill(Qt::transparent);
 
-    if (bstop){
-        return;
+        p.setClipRegion(mdata.current_region);
+        p.drawImage(QRect(0, 0, mdata.width, mdata.height), /**current_image*/mdata.current_image, mdata.current_rect);
+
+        if (isCancelled()) {
+            return;
+        }
+        p.setClipRegion(mdata.next_region);
+        p.drawImage(QRect(0, 0, mdata.width, mdata.height), /**next_image*/mdata.next_image, mdata.next_rect);
+        p.end();
     }
-    p.setClipRegion(mdata.next_region);
-    p.drawImage(QRect(0, 0, mdata.width, mdata.height), /**next_image*/mdata.next_image, mdata.next_rect);
-    if (bstop)
-        return;
-    emit signal_RenderFinish(mdata.num, image);
 
 //    qDebug() << "-------renderFrame end num:" << mdata.num;
 }
@@ -94,38 +130,50 @@ void ThreadRenderFrame::run()
 
 SlideEffect *SlideEffect::create(const EffectId &id)
 {
-    if (id == EffectId()) {
-        srand(time(0));
-        int count = 0; // To avoid find no match effect
-        while (true || count < 100) {
-            QList<std::function<SlideEffect*()>> cs = effects.values();
-            const int idx = rand() % cs.size();
-            std::function<SlideEffect*()> c = cs.at(idx);
-
-
-            SlideEffect *e = c();
-            // Check if effect should show
-            if (dApp->setter->value(EFFECT_SETTING_GROUP,
-                                    QString::number(e->effectName()),
-                                    true).toBool()) {
-                return e;
-            }
-            count ++;
-        }
-        return NULL;
-    }
+    if (id == EffectId())
+        return create(randomType());
     if (effects.contains(id))
         return effects.value(id)();
     return NULL;
 }
 
-void SlideEffect::Register(EffectId id, std::function<SlideEffect*()> c)
+EffectId SlideEffect::randomType()
+{
+    static bool seeded = false;
+    if (!seeded) {
+        srand(time(0));
+        seeded = true;
+    }
+    // Check if effect should show
+    QList<EffectId> ids;
+    for (auto it = effectNames.constBegin(); it != effectNames.constEnd(); ++it) {
+        if (dApp->setter->value(EFFECT_SETTING_GROUP,
+                                QString::number(it.value()),
+                                true).toBool()) {
+            ids << it.key();
+        }
+    }
+    // To avoid find no match effect
+    if (ids.isEmpty())
+        ids = effectNames.keys();
+    if (ids.isEmpty())
+        return kInvalid;
+    return ids.at(rand() % ids.size());
+}
+
+SlideEffect::EffectName SlideEffect::effectNameOf(const EffectId &id)
+{
+    return effectNames.value(id, Slide);
+}
+
+void SlideEffect::Register(EffectId id, EffectName name, std::function<SlideEffect*()> c)
 {
     if (effects.contains(id)) {
         effects.remove(id);
     }
 
     effects.insert(id, c);
+    effectNames.insert(id, name);
 }
 
 SlideEffect::SlideEffect()
@@ -144,42 +192,55 @@ SlideEffect::SlideEffect()
     ,height(0)
     ,color(Qt::transparent)
     ,easing_(QEasingCurve(QEasingCurve::OutBack))
+    ,m_cancel(new QAtomicInt(0))
 {
-    QThreadPool::globalInstance()->setMaxThreadCount(3);
-//    m.setMaxThreadCount(20);
+    //渲染线程池有空位时继续提交，池中的帧可能属于其他效果实例
+    connect(SlideRenderPool::instance(), &SlideRenderPool::capacityAvailable, this, [ = ] {
+        while (submitFrame()) {
+        }
+    });
 //    connect(this, &SlideEffect::renderFrameFinish, this, &SlideEffect::slotrenderFrameFinish);
 }
 
-void SlideEffect::slotrenderFrameFinish(int num, QImage image)
+void SlideEffect::slotrenderFrameFinish(int generation, int num, QImage image)
 {
-    allImage[num] = image;
-    if(image.isNull()){
-        qDebug() << "image.isNull";
-    }
-    //定时器改线程同步,add by hujianbo
-    if (num == m_nNum) {
-        m_nNum = -1;
-        int nCount = 0;
-        QMap<int, QImage>::iterator iter = allImage.begin();
-        while (iter != allImage.end()) {
-            if(nCount > allImage.size()+100){
-                break;//如果延迟500ms还没有结果，先退出，时间后续根据测试情况再确定
-            }
-            nCount ++;
-            if (iter.value().isNull()){
-                QThread::msleep(5);
-                --iter ;
+    if (generation != m_generation) {
+        //上一次切换的帧，当前切换仍在使用同样大小的缓冲时回收，否则释放
+        m_staleInFlight--;
+        if (!image.isNull() && image.size() == QSize(width, height) && !m_frames.isEmpty()) {
+            m_freeBuffers.append(image);
+            while (submitFrame()) {
             }
-            ++iter ;
+        } else {
+            m_bufferCount--;
         }
+        return;
+    }
+    m_inFlight--;
+    if(image.isNull()){
+        //这一帧不会再有结果，按已结束处理，否则最后一帧永远等不到
+        qWarning() << "slide effect frame" << num << "failed to render";
+        m_bufferCount--;
+        skipToEnd();
+        return;
+    } else if (num < scurrent) {
+        //已经错过显示时间的帧直接回收
+        m_freeBuffers.append(image);
+    } else {
+        allImage[num] = image;
+    }
+    //首批帧渲染完成后再开始计时显示
+    if (m_waitFirstFrames && m_inFlight == 0) {
+        m_waitFirstFrames = false;
         tid = startTimer(1);
     }
+    while (submitFrame()) {
+    }
 }
 
 SlideEffect::~SlideEffect()
 {
 //    qDebug() << "------------SlideEffect start release";
-    disconnect(this, &SlideEffect::renderFrameFinish, this, &SlideEffect::slotrenderFrameFinish);
 
     if (current_image) {
         delete current_image;
@@ -189,13 +250,8 @@ SlideEffect::~SlideEffect()
         delete next_image;
         next_image = nullptr;
     }
-    if (frame_image) {
-        delete frame_image;
-        frame_image = nullptr;
-    }
-    //清除无用代码
-    allImage.clear();
-    malloc_trim(0);
+    //清除无用代码，内存归还系统在幻灯片结束时统一进行
+    clearFrameBuffers();
     qDebug() << "-------------SlideEffect end release";
 }
 
@@ -226,17 +282,20 @@ int SlideEffect::duration() const
 
 void SlideEffect::start()
 {
-    //清楚没用代码
-    allImage.clear();
-    allImage[frames_total] = *next_image;
+    //复用上一次切换的帧缓冲，大小变化的缓冲释放后按新大小重新分配
+    reset();
     prepare();
     current_frame = 0;
+    for (int i = m_freeBuffers.size() - 1; i >= 0; i--) {
+        if (m_freeBuffers.at(i).size() != QSize(width, height)) {
+            m_freeBuffers.removeAt(i);
+            m_bufferCount--;
+        }
+    }
 
+    //先只计算每一帧的裁剪区域，像素在显示前按环形缓冲的容量分批渲染
     m_readlock.lockForRead();
     for (int i = 0; i < frames_total; i++) {
-        if (i == frames_total-1) {
-            m_nNum = frames_total;
-        }
         if (!prepareNextFrame()) {
             stop();
             m_readlock.unlock();
@@ -244,23 +303,135 @@ void SlideEffect::start()
         }
     }
     m_readlock.unlock();
-//    m_qf = QtConcurrent::run([this]() {
-//        for (int i = 0; i < frames_total; i++) {
-//            if (!prepareNextFrame()) {
-//                stop();
-//                return;
-//            }
-//        }
-//    });
-
-//    QEventLoop loop;
-//    QTimer::singleShot(all_ms - duration_ms, &loop, SLOT(quit()));
-//    loop.exec();
+
+    scurrent = 1;
+    bfirsttimeout = true;
+    m_waitFirstFrames = true;
+    setTransitionActive(true);
+    while (submitFrame()) {
+    }
+}
+
+bool SlideEffect::submitFrame()
+{
+    //已经错过显示时间的帧不再渲染，最后一帧始终保留
+    while (m_nextSubmit < scurrent && m_nextSubmit < m_frames.size()) {
+        m_nextSubmit++;
+    }
+    if (m_nextSubmit > m_frames.size()) {
+        return false;
+    }
+    //渲染中的帧数达到上限时等待线程池空出位置
+    if (!SlideRenderPool::instance()->hasCapacity()) {
+        return false;
+    }
+    QImage buffer;
+    if (!m_freeBuffers.isEmpty()) {
+        buffer = m_freeBuffers.takeFirst();
+    } else if (m_bufferCount < FRAME_RING_SIZE) {
+        buffer = QImage(width, height, QImage::Format_ARGB32);
+        if (buffer.isNull()) {
+            //分配失败时用已有的缓冲继续，一块可用的都没有时直接结束本次切换
+            if (m_inFlight == 0 && allImage.isEmpty()) {
+                skipToEnd();
+            }
+            return false;
+        }
+        m_bufferCount++;
+    } else {
+        return false;
+    }
+
+    const SlideEffectFrame &frame = m_frames.at(m_nextSubmit - 1);
+    SlideEffectThreadData data;
+    data.cancel = m_cancel;
+    data.mimage.swap(buffer);
+    data.generation = m_generation;
+    data.num = m_nextSubmit;
+    data.current_region = frame.current_region;
+    data.next_region = frame.next_region;
+    data.width = width;
+    data.height = height;
+    //源图隐式共享，只增加引用计数
+    data.current_image = *current_image;
+    data.next_image = *next_image;
+    data.current_rect = frame.current_rect;
+    data.next_rect = frame.next_rect;
+    ThreadRenderFrame *threadf = new ThreadRenderFrame();
+    connect(threadf, &ThreadRenderFrame::signal_RenderFinish, this, &SlideEffect::slotrenderFrameFinish);
+    threadf->setData(data);
+    if (!SlideRenderPool::instance()->tryStart(threadf)) {
+        m_freeBuffers.prepend(threadf->takeBuffer());
+        delete threadf;
+        return false;
+    }
+    m_inFlight++;
+    m_nextSubmit++;
+    return true;
+}
+
+void SlideEffect::recycleFrame(const QImage &image)
+{
+    //显示端在收到下一帧之前仍持有上一帧，所以最近显示的几帧暂不复用
+    m_presentedBuffers.append(image);
+    while (m_presentedBuffers.size() > FRAME_PRESENTED_HOLD) {
+        QImage buffer = m_presentedBuffers.takeFirst();
+        if (buffer.size() == QSize(width, height)) {
+            m_freeBuffers.append(buffer);
+        } else {
+            m_bufferCount--;
+        }
+    }
+    while (submitFrame()) {
+    }
+}
+
+void SlideEffect::reset()
+{
+    killTimer(tid);
+    tid = 0;
+    setTransitionActive(false);
+    //未返回的帧作废并取消渲染，已渲染未显示的帧直接回到空闲缓冲
+    m_cancel->storeRelease(1);
+    m_cancel.reset(new QAtomicInt(0));
+    m_generation++;
+    m_staleInFlight += m_inFlight;
+    m_inFlight = 0;
+    for (const QImage &image : allImage) {
+        m_freeBuffers.append(image);
+    }
+    allImage.clear();
+    m_frames.clear();
+    m_nextSubmit = 1;
+    m_waitFirstFrames = false;
+    m_droppedFrames = 0;
+    m_presentClock.invalidate();
+    m_pausedMs = 0;
     scurrent = 0;
     bfirsttimeout = true;
-    //tid = startTimer(all_ms - duration_ms - 1000);
+}
+
+void SlideEffect::adoptFrameBuffers(SlideEffect *other)
+{
+    if (!other || other == this)
+        return;
+    other->reset();
+    const int count = other->m_freeBuffers.size() + other->m_presentedBuffers.size();
+    m_freeBuffers.append(other->m_freeBuffers);
+    m_presentedBuffers.append(other->m_presentedBuffers);
+    other->m_freeBuffers.clear();
+    other->m_presentedBuffers.clear();
+    other->m_bufferCount -= count;
+    m_bufferCount += count;
+}
 
-//    tid = startTimer(duration() / frames_total);
+void SlideEffect::clearFrameBuffers()
+{
+    reset();
+    m_freeBuffers.clear();
+    m_presentedBuffers.clear();
+    //还在渲染线程中的缓冲返回后释放
+    m_bufferCount = m_staleInFlight;
 }
 
 void SlideEffect::stop()
@@ -273,6 +444,36 @@ void SlideEffect::stop()
 void SlideEffect::pause()
 {
     paused = !paused;
+    //暂停期间不计入帧调度的时间
+    if (m_presentClock.isValid()) {
+        if (paused) {
+            m_pauseStartMs = m_presentClock.elapsed();
+        } else {
+            m_pausedMs += m_presentClock.elapsed() - m_pauseStartMs;
+        }
+    }
+}
+
+void SlideEffect::setTransitionActive(bool active)
+{
+    if (m_transitionActive == active)
+        return;
+    m_transitionActive = active;
+    if (active) {
+        SlideRenderPool::instance()->beginTransition();
+    } else {
+        SlideRenderPool::instance()->endTransition();
+    }
+}
+
+int SlideEffect::droppedFrames() const
+{
+    return m_droppedFrames;
+}
+
+qint64 SlideEffect::presentClock() const
+{
+    return m_presentClock.elapsed() - m_pausedMs;
 }
 
 void SlideEffect::timerEvent(QTimerEvent *e)
@@ -286,30 +487,83 @@ void SlideEffect::timerEvent(QTimerEvent *e)
 //    Q_EMIT frameReady(*currentFrame());
     if (bfirsttimeout) {
         stop();
-        tid = startTimer(duration() / (frames_total + 1));
+        //按时间戳决定显示哪一帧，定时器只负责按刷新周期检查，不在线程中睡眠等待
+        m_frameInterval = qMax(1, duration() / (frames_total + 1));
+        tid = startTimer(qMin(FRAME_TICK_MS, m_frameInterval), Qt::PreciseTimer);
 //        tid = startTimer(20);
+        m_presentClock.start();
+        m_pausedMs = 0;
         bfirsttimeout = false;
     } else {
-        while (true) {
-            if (scurrent > frames_total)
-                return;
-            QMap<int, QImage>::iterator it;
-            it = allImage.find(scurrent);
-            scurrent++;
-            if (it != allImage.end()) {
-                Q_EMIT frameReady(it.value());
-                return;
-            }
-        }
+        presentDueFrame();
     }
 }
 
-bool SlideEffect::prepare()
+void SlideEffect::presentDueFrame()
+{
+    int target = qMin<qint64>(m_frames.size(), presentClock() / m_frameInterval);
+    if (target < scurrent)
+        return;
+    //取已到期的最新一帧，到期帧还没有渲染完成时先显示之前已完成的帧
+    QMap<int, QImage>::iterator it = allImage.upperBound(target);
+    if (it == allImage.begin())
+        return;
+    --it;
+    const int num = it.key();
+    QImage image = it.value();
+    allImage.erase(it);
+
+    //跳过的帧不再显示，缓冲直接回收
+    m_droppedFrames += num - scurrent;
+    it = allImage.begin();
+    while (it != allImage.end() && it.key() < num) {
+        m_freeBuffers.append(it.value());
+        it = allImage.erase(it);
+    }
+    scurrent = num + 1;
+
+    Q_EMIT frameReady(image);
+    recycleFrame(image);
+
+    if (num == m_frames.size()) {
+        finishTransition();
+    }
+}
+
+void SlideEffect::skipToEnd()
 {
-    if (!frame_image) {
-        frame_image = new QImage(width, height, QImage::Format_ARGB32);
-        frame_image->fill(0);
+    const int last = m_frames.size();
+    if (scurrent > last)
+        return;
+    //未显示的帧都计为掉帧，还在渲染的帧取消，返回后因为早于scurrent直接回收
+    m_droppedFrames += last - scurrent + 1;
+    scurrent = last + 1;
+    m_nextSubmit = last + 1;
+    m_waitFirstFrames = false;
+    m_cancel->storeRelease(1);
+    for (const QImage &image : allImage) {
+        m_freeBuffers.append(image);
+    }
+    allImage.clear();
+    //最后一帧就是铺满背景后的下一张图
+    if (next_image && !next_image->isNull()) {
+        Q_EMIT frameReady(*next_image);
     }
+    finishTransition();
+}
+
+void SlideEffect::finishTransition()
+{
+    killTimer(tid);
+    tid = 0;
+    setTransitionActive(false);
+    qDebug() << "slide effect" << effect_type << "dropped frames:" << m_droppedFrames
+             << "of" << m_frames.size();
+    Q_EMIT stopped();
+}
+
+bool SlideEffect::prepare()
+{
     resizeImages();
     tid = 0;
     finished = false;
@@ -325,36 +579,12 @@ bool SlideEffect::prepareNextFrame()
 {
     //current_frame++? do not paint frame 0?
     if (prepareFrameAt(++current_frame)) {
-//        renderFrame(current_frame, current_clip_region, next_clip_region);
-
-//        virtual void renderFrame(QImage mimage, int num, QRegion current_region, QRegion next_region, int width, int height
-//                                 , QImage current_image, QImage next_image, QRect current_rect, QRect next_rect);
-        SlideEffectThreadData data;
-        data.mimage = *frame_image;
-        data.num = current_frame;
-        data.current_region = current_clip_region;
-        data.next_region = next_clip_region;
-        data.width = width;
-        data.height = height;
-        data.current_image = *current_image;
-        data.next_image = *next_image;
-        data.current_rect = current_rect;
-        data.next_rect = next_rect;
-        ThreadRenderFrame *threadf = new ThreadRenderFrame();
-        connect(threadf, &ThreadRenderFrame::signal_RenderFinish, this, &SlideEffect::slotrenderFrameFinish);
-        connect(this, &SlideEffect::deleteLater, threadf, &ThreadRenderFrame::stop);
-        threadf->setData(data);
-        QThreadPool::globalInstance()->start(threadf);
-//        m.start(threadf);
-//        QFuture<void> res = QtConcurrent::run(this, &SlideEffect::renderFrame, data);
-        //        QFuture<void> res = QtConcurrent::run(this, &SlideEffect::renderFrame, *frame_image, current_frame, current_clip_region, next_clip_region,
-//                                              width, height, *current_image, *next_image, current_rect, next_rect);
-
-//        QFuture<void> res = QtConcurrent::run([this]() {
-//            renderFrame(*frame_image, current_frame, current_clip_region, next_clip_region,
-//                        width, height, *current_image, *next_image, current_rect, next_rect);
-//        });
-//        m_qflist.append(res);
+        SlideEffectFrame frame;
+        frame.current_region = current_clip_region;
+        frame.next_region = next_clip_region;
+        frame.current_rect = current_rect;
+        frame.next_rect = next_rect;
+        m_frames.append(frame);
         return true;
     }
     return false;
@@ -476,10 +706,6 @@ void SlideEffect::resizeImages()
             addBackground(next_image, width, height, color);
         }
     }
-
-    if (frame_image && frame_image->size() != QSize(width, height)) {
-        *frame_image = frame_image->scaled(width, height);
-    }
 }
 
 bool SlideEffect::isEndFrame(int frame)
@@ -505,7 +731,7 @@ bool SlideEffect::isEndFrame(int frame)
 void SlideEffect::clearimagemap()
 {
     //清除无用代码
-    allImage.clear();
+    clearFrameBuffers();
 }
 
 
@@ -23,6 +23,8 @@
 #include <QtCore/QObject>
 #include <QtCore/QEasingCurve>
 #include <QMap>
+#include <QElapsedTimer>
+#include <QSharedPointer>
 #include <QtConcurrent>
 typedef QString EffectId;
 
@@ -44,7 +46,23 @@ static const EffectId kRandom = "random";
     QPainter painter(this);
     painter.drawPixmap(rect(), *mEffect->currentFrame());
 */
+/*!
+  单帧的裁剪区域，提前计算好，绘制时再取用
+*/
+struct SlideEffectFrame {
+    QRegion current_region;
+    QRegion next_region;
+    QRect current_rect;
+    QRect next_rect;
+};
+/*!
+  mimage为环形缓冲中的帧缓冲，只被渲染线程持有，绘制时不会深拷贝；
+  current_image和next_image为隐式共享的源图，不会复制像素；
+  cancel在效果重置或销毁时置位，尚未完成的帧不再渲染
+*/
 struct SlideEffectThreadData {
+    QSharedPointer<QAtomicInt> cancel;
+    int generation;
     int num;
     int width;
     int height;
@@ -63,17 +81,21 @@ public:
     ThreadRenderFrame();
     ~ThreadRenderFrame();
     void setData(SlideEffectThreadData &data);
-public Q_SLOTS:
-    void stop();
+    /*!
+        任务未能提交时取回帧缓冲
+    */
+    QImage takeBuffer();
 
 protected:
     virtual void run();
 
 signals:
-    void signal_RenderFinish(int, QImage);
+    void signal_RenderFinish(int, int, QImage);
 private:
+    bool isCancelled() const;
+    void render(QImage &image);
+
     SlideEffectThreadData m_data;
-    bool bstop = false;
 };
 class SlideEffect : public QObject
 {
@@ -87,10 +109,15 @@ public:
     };
     // default id will return an object randomly
     static SlideEffect *create(const EffectId &id = EffectId());
-    template<class C> static void registerEffect(const EffectId &id)
+    template<class C> static void registerEffect(const EffectId &id, EffectName name)
     {
-        Register(id, std::bind(create<C>, id));
+        Register(id, name, std::bind(create<C>, id));
     }
+    /*!
+      按设置中启用的效果随机选择一种切换类型
+    */
+    static EffectId randomType();
+    static EffectName effectNameOf(const EffectId &id);
 
     SlideEffect();
     virtual ~SlideEffect();
@@ -120,6 +147,21 @@ public:
     void setSize(const QSize &s);
     QSize size() const;
 
+    /*!
+        本次切换中因渲染不及时而跳过的帧数
+    */
+    int droppedFrames() const;
+
+    /*!
+        复用同一个实例开始下一次切换：停止计时、丢弃未显示的帧，帧缓冲保留继续使用。
+        之前提交但还未返回的帧按代数区分，返回后只回收缓冲
+    */
+    void reset();
+    /*!
+        切换到另一种效果时接管上一个效果的帧缓冲，整个幻灯片播放期间只保留一组缓冲
+    */
+    void adoptFrameBuffers(SlideEffect *other);
+
 
 Q_SIGNALS:
     void renderFrameFinish(int num, QImage image);
@@ -131,7 +173,7 @@ public Q_SLOTS:
     void start();
     void stop();
     void pause();
-    void slotrenderFrameFinish(int num, QImage image);
+    void slotrenderFrameFinish(int generation, int num, QImage image);
     void clearimagemap();
 protected:
     virtual void timerEvent(QTimerEvent *e) override;
@@ -145,6 +187,36 @@ protected:
     void resizeImages(); //resize to given size with given scale type
     virtual bool isEndFrame(int frame) ; //TODO: do not change progress
 
+    /*!
+        从环形缓冲取一块空闲帧缓冲提交下一帧渲染，没有空闲缓冲或没有剩余帧时返回false
+    */
+    bool submitFrame();
+    /*!
+        已显示的帧在显示端释放之后回到空闲缓冲，并继续提交后续帧
+    */
+    void recycleFrame(const QImage &image);
+    /*!
+        释放所有帧缓冲，只在幻灯片结束时调用
+    */
+    void clearFrameBuffers();
+    /*!
+        按时间戳显示当前到期的最新一帧，之前未显示的帧计为掉帧
+    */
+    void presentDueFrame();
+    /*!
+        帧缓冲分配或渲染失败时不再等待剩余帧，直接显示切换后的图片并结束本次切换
+    */
+    void skipToEnd();
+    /*!
+        最后一帧已显示或被跳过：停止计时、恢复后台加载并发出stopped
+    */
+    void finishTransition();
+    /*!
+        切换进行期间通知渲染线程池，后台缩略图加载让出CPU
+    */
+    void setTransitionActive(bool active);
+    qint64 presentClock() const;
+
 protected:
     bool finished;
     bool paused;
@@ -158,7 +230,7 @@ protected:
     EffectId effect_type;
     int frames_total, current_frame;
     //if current_image is null, just paint next_image inside
-    QImage *frame_image{nullptr}, *current_image{nullptr}, *next_image{nullptr};
+    QImage *current_image{nullptr}, *next_image{nullptr};
     int width, height;
     //clip region of currentFrame() to paint current and next frame_image
     QRegion current_clip_region, next_clip_region;
@@ -173,7 +245,29 @@ protected:
     QString  current_path, next_path;
     QColor color;
     QEasingCurve easing_;
+    //已渲染、等待显示的帧
     QMap<int, QImage> allImage;
+    //每一帧的裁剪区域，下标为帧号-1
+    QVector<SlideEffectFrame> m_frames;
+    //环形帧缓冲：空闲的缓冲、已显示但可能仍被显示端引用的缓冲
+    QList<QImage> m_freeBuffers;
+    QList<QImage> m_presentedBuffers;
+    int m_bufferCount = 0;
+    int m_nextSubmit = 1;
+    int m_inFlight = 0;
+    //之前的切换提交、尚未返回的帧
+    int m_staleInFlight = 0;
+    int m_generation = 0;
+    //当前切换的取消标记，与已提交的渲染任务共享
+    QSharedPointer<QAtomicInt> m_cancel;
+    bool m_transitionActive = false;
+    bool m_waitFirstFrames = false;
+    //帧调度：第一帧开始显示时计时，第n帧在n个帧间隔后到期
+    QElapsedTimer m_presentClock;
+    qint64 m_pausedMs = 0;
+    qint64 m_pauseStartMs = 0;
+    int m_frameInterval = 1;
+    int m_droppedFrames = 0;
     int scurrent = 0;
     //QFuture<void> m_qf;
     //QList<QFuture<void>> m_qflist;
@@ -187,16 +281,17 @@ private:
         e->setType(id);
         return e;
     }
-    static void Register(EffectId id, std::function<SlideEffect*()> c);
+    static void Register(EffectId id, EffectName name, std::function<SlideEffect*()> c);
 
     static QHash<EffectId, std::function<SlideEffect*()> > effects;
+    static QHash<EffectId, EffectName> effectNames;
 };
 
 #define REGISTER_EFFECTS(T) \
 static void register_effects() { \
     T* e = new T(); \
     foreach (EffectId id, e->supportedTypes()) { \
-        SlideEffect::registerEffect<T>(id); \
+        SlideEffect::registerEffect<T>(id, e->effectName()); \
     } \
     delete e; \
 } \
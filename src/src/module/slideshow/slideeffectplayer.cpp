@@ -30,6 +30,11 @@ namespace {
 
 const QString DURATION_SETTING_GROUP = "SLIDESHOWDURATION";
 const QString DURATION_SETTING_KEY = "Duration";
+const QString CACHE_SETTING_GROUP = "SLIDESHOWCACHE";
+const QString CACHE_LOOKAHEAD_KEY = "LookAhead";
+const QString CACHE_BUDGET_KEY = "MemoryBudgetMB";
+const int CACHE_LOOKAHEAD = 2;
+const int CACHE_BUDGET_MB = 256;
 const int ANIMATION_DURATION  = 1000;
 const int SLIDER_DURATION  = 3000;
 const int ANIMATION_DURATION_4K  = 2300;
@@ -69,13 +74,10 @@ SlideEffectPlayer::SlideEffectPlayer(QObject *parent)
 
 SlideEffectPlayer::~SlideEffectPlayer()
 {
+    releaseEffects();
     if (m_thread.isRunning()) {
         m_thread.quit();
-    }
-
-    if (m_effect) {
-        delete m_effect;
-        m_effect = nullptr;
+        m_thread.wait();
     }
 }
 
@@ -119,6 +121,7 @@ void SlideEffectPlayer::setFrameSize(int width, int height)
 {
     m_w = width;
     m_h = height;
+    m_cache.setDecodeSize(QSize(width, height));
 }
 
 void SlideEffectPlayer::setImagePaths(const QStringList &paths)
@@ -175,6 +178,10 @@ void SlideEffectPlayer::start()
         return;
 
     bfirstrun = true;
+    m_cache.setLookAhead(dApp->setter->value(CACHE_SETTING_GROUP, CACHE_LOOKAHEAD_KEY,
+                                             CACHE_LOOKAHEAD).toInt());
+    m_cache.setMemoryBudget(qint64(dApp->setter->value(CACHE_SETTING_GROUP, CACHE_BUDGET_KEY,
+                                                       CACHE_BUDGET_MB).toInt()) * 1024 * 1024);
     cacheNext();
     cachePrevious();
     m_running = true;
@@ -219,8 +226,6 @@ bool SlideEffectPlayer::startNext()
         //return false;
     //}
 
-    if (m_effect)
-        m_effect->deleteLater();
     QString oldPath,newPath;
     m_oldpath = m_paths[m_current];
 
@@ -248,53 +253,16 @@ bool SlideEffectPlayer::startNext()
      //   oldImg = utils::image::getRotatedImage(oldPath);
    // if(newPath.isEmpty())
      //   newPath = m_paths[m_current];
-    m_effect = SlideEffect::create("");
-//    m_effect = SlideEffect::create("enter_from_right");
-//    if ((m_screenrect.width()*m_ratio) < 3000 && (m_screenrect.height()*m_ratio) < 3000) {
-
     //maozhengyu 点击下一张图片加载延时
-    if (!bstartnext) {
-        if (!b_4k) {
-            m_effect->setDuration(ANIMATION_DURATION);
-            m_effect->setAllMs(SLIDER_DURATION);
-        } else {
-            //        qDebug() << "------------------4K";
-            m_effect->setDuration(ANIMATION_DURATION_4K);
-            m_effect->setAllMs(SLIDER_DURATION_4K);
-        }
-    } else {
-        if (!b_4k) {
-            m_effect->setDuration(ANIMATION_DURATION);
-            //        m_effect->setAllMs(SLIDER_DURATION);
-            m_effect->setAllMs(2200);
-        } else {
-            //        qDebug() << "------------------4K";
-            m_effect->setDuration(ANIMATION_DURATION_4K);
-            //        m_effect->setAllMs(SLIDER_DURATION_4K);
-            m_effect->setAllMs(3500);
-        }
+    int duration = b_4k ? ANIMATION_DURATION_4K : ANIMATION_DURATION;
+    int allMs = b_4k ? SLIDER_DURATION_4K : SLIDER_DURATION;
+    if (bstartnext) {
+        allMs = b_4k ? 3500 : 2200;
         bstartnext = false;
     }
-    m_effect->setSize(fSize);
-
-    using namespace utils::image;
-
-//    QImage newImg = m_cacheImages.value(newPath);
-//    if(newImg.isNull())
-//        newImg = utils::image::getRotatedImage(newPath);
-// The "newPath" would be the next "oldPath", so there is no need to remove it now
-//    m_cacheImages.remove(oldPath);
-    m_effect->setImages(m_cacheImages.value(m_oldpath), m_cacheImages.value(m_newpath));
-    if (!m_thread.isRunning())
-        m_thread.start();
-
-    m_effect->moveToThread(&m_thread);
-    connect(m_effect, &SlideEffect::frameReady, this, [ = ] (const QImage & img) {
-        if (m_running) {
-            Q_EMIT frameReady(img);
-        }
-    }, Qt::DirectConnection);
-    QMetaObject::invokeMethod(m_effect, "start");
+    if (!startEffect(SlideEffect::randomType(), duration, allMs)) {
+        return false;
+    }
 
 
     if (m_current == m_paths.length() - 1) {
@@ -333,8 +301,6 @@ bool SlideEffectPlayer::startPrevious()
     //return false;
     // }
 
-    if (m_effect)
-        m_effect->deleteLater();
 
     m_oldpath = m_paths[m_current];
 
@@ -348,53 +314,67 @@ bool SlideEffectPlayer::startPrevious()
     cachePrevious();
 
     m_newpath = m_paths[m_current];
-    m_effect = SlideEffect::create("enter_from_left");
-    if (!b_4k) {
-        m_effect->setDuration(ANIMATION_DURATION);
-//        m_effect->setAllMs(SLIDER_DURATION);
-
-        m_effect->setAllMs(2200);
-    } else {
-        qDebug() << "------------------4K";
-        m_effect->setDuration(ANIMATION_DURATION_4K);
-//        m_effect->setAllMs(SLIDER_DURATION_4K);
-
-        m_effect->setAllMs(3500);
-    }
-    m_effect->setSize(fSize);
-
-    using namespace utils::image;
-    qDebug() << "m_cacheImages.value";
-//    // QImage oldImg = m_cacheImages.value(oldPath);
-//    QImage oldImg = utils::image::getRotatedImage(oldPath);
-//    // QImage newImg = m_cacheImages.value(newPath);
-//    QImage newImg = utils::image::getRotatedImage(newPath);
-//    if (newImg.isNull()) {
-//        if (m_current > 0)
-//            newPath = m_paths[m_current];
-//        else {
-//            m_current = m_paths.length() - 1;
-//        }
-//        newImg = utils::image::getRotatedImage(newPath);
-//    }
-    // The "newPath" would be the next "oldPath", so there is no need to remove it now
-
-//    m_cacheImages.remove(oldPath);
+    return startEffect("enter_from_left", b_4k ? ANIMATION_DURATION_4K : ANIMATION_DURATION,
+                       b_4k ? 3500 : 2200);
+}
 
-    m_effect->setImages(m_cacheImages[m_oldpath], m_cacheImages[m_newpath]);
-    if (!m_thread.isRunning())
-        m_thread.start();
+bool SlideEffectPlayer::startEffect(const EffectId &id, int duration, int allMs)
+{
+    //每种效果在一次播放中只创建一个实例，切换时重新设置参数后复用
+    const SlideEffect::EffectName name = SlideEffect::effectNameOf(id);
+    SlideEffect *effect = m_effects.value(name);
+    if (!effect) {
+        effect = SlideEffect::create(id);
+        if (!effect) {
+            qWarning() << "Invalid slide effect" << id;
+            return false;
+        }
+        if (!m_thread.isRunning())
+            m_thread.start();
+        effect->moveToThread(&m_thread);
+        connect(effect, &SlideEffect::frameReady, this, [ = ] (const QImage & img) {
+            if (m_running) {
+                Q_EMIT frameReady(img);
+            }
+        }, Qt::DirectConnection);
+        m_effects.insert(name, effect);
+    }
 
-    m_effect->moveToThread(&m_thread);
-    connect(m_effect, &SlideEffect::frameReady, this, [ = ] (const QImage & img) {
-        if (m_running) {
-            Q_EMIT frameReady(img);
+    SlideEffect *previous = m_effect;
+    m_effect = effect;
+    const QSize fSize(m_w, m_h);
+    const QImage oldImg = m_cache.image(m_oldpath);
+    const QImage newImg = m_cache.image(m_newpath);
+    //效果对象在渲染线程中，参数在该线程中设置，避免与正在进行的切换竞争
+    QMetaObject::invokeMethod(effect, [ = ] {
+        if (previous && previous != effect) {
+            effect->adoptFrameBuffers(previous);
         }
-    }, Qt::DirectConnection);
-    QMetaObject::invokeMethod(m_effect, "start");
+        effect->setType(id);
+        effect->setDuration(duration);
+        effect->setAllMs(allMs);
+        effect->setSize(fSize);
+        effect->setImages(oldImg, newImg);
+        effect->start();
+    }, Qt::QueuedConnection);
     return true;
 }
 
+void SlideEffectPlayer::releaseEffects()
+{
+    //释放帧缓冲后再删除，内存在幻灯片结束时一次归还系统
+    for (SlideEffect *effect : m_effects) {
+        if (m_thread.isRunning()) {
+            QMetaObject::invokeMethod(effect, "clearimagemap", Qt::BlockingQueuedConnection);
+            effect->deleteLater();
+        } else {
+            delete effect;
+        }
+    }
+    m_effects.clear();
+    m_effect = nullptr;
+}
+
 void SlideEffectPlayer::cacheNext()
 {
     qDebug() << "SlideEffectPlayer::cacheNext()";
@@ -430,37 +410,12 @@ void SlideEffectPlayer::cacheNext()
     //Load current pixmap for fix bug 21480
     if(bfirstrun)
     {
-        QString curpath = m_paths[m_current];
-        if (m_cacheImages.value(curpath).isNull())
-        {
-            QImage img = utils::image::getRotatedImage(curpath);
-            m_cacheImages.insert(curpath, img);
-        }
+        m_cache.load(m_paths[m_current]);
     }
 
-    if (m_cacheImages.value(path).isNull()) {
-        CacheThread *t = new CacheThread(path);
-        connect(t, &CacheThread::cached,
-        this, [ = ] (const QString path, const QImage img) {
-            //free memory
-            //只有一张图片不加载下一张
-            if(m_paths.length()<2) return;
-            int rmindex = m_current-2;
-            if(-1 == rmindex)
-                rmindex = m_paths.length()-1;
-            else if(-2 == rmindex)
-                rmindex = m_paths.length()-2;
-            if(m_paths.length() != 2 && rmindex>-1)
-            {
-                QString rmpath = m_paths[rmindex];
-                m_cacheImages.remove(rmpath);
-            }
-            m_cacheImages.insert(path, img);
-
-        });
-        connect(t, &CacheThread::finished, t, &CacheThread::deleteLater);
-        t->start();
-    }
+    //只有一张图片不加载下一张
+    if (m_paths.length() < 2) return;
+    m_cache.prefetch(m_paths, m_current);
 }
 
 void SlideEffectPlayer::cachePrevious()
@@ -484,28 +439,9 @@ void SlideEffectPlayer::cachePrevious()
         emit dApp->signalM->sendLoadSignal(true);
         emit dApp->signalM->sigGetFirstThumbnailpath(m_FirstThumbnailPath);
     }
-    if (m_cacheImages.value(path).isNull()) {
-        CacheThread *t = new CacheThread(path);
-        connect(t, &CacheThread::cached,
-        this, [ = ] (const QString path, const QImage img) {
-            //修复只有一张图片不加载上一张
-            if(m_paths.length() < 2) return;
-            qDebug() << "m_cacheImagespre.insert(path, img)";
-            int rmindex = m_current+2;
-            if(m_paths.size() == rmindex)
-                rmindex = 0;
-            else if(m_paths.size()+1 == rmindex)
-                rmindex = 1;
-            if(m_paths.length() != 2 && rmindex!= -1)
-            {
-                QString rmpath = m_paths[rmindex];
-                m_cacheImages.remove(rmpath);
-            }
-            m_cacheImages.insert(path, img);
-        });
-        connect(t, &CacheThread::finished, t, &CacheThread::deleteLater);
-        t->start();
-    }
+    //修复只有一张图片不加载上一张
+    if (m_paths.length() < 2) return;
+    m_cache.prefetch(m_paths, m_current);
 }
 
 void SlideEffectPlayer::setStartNextFlag(bool flag)
@@ -524,13 +460,10 @@ void SlideEffectPlayer::stop()
 
     killTimer(m_tid);
     //LMH0601 解决29706 【看图】【5.6.3.5】【sp1】播放幻灯片时，在第一张图片上双击鼠标，应用闪退
-    if(nullptr!=m_effect)
-    {
-        m_effect->clearimagemap();
-    }
+    releaseEffects();
     //删除无用代码，修复style问题
     m_tid = 0;
     m_running = false;
-    m_cacheImages.clear();
+    m_cache.clear();
     Q_EMIT finished();
 }
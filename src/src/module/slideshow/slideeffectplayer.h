@@ -17,34 +17,13 @@
 #pragma once
 #include "utils/imageutils.h"
 #include "slideeffect.h"
+#include "slideimagecache.h"
 #include <QThread>
+#include <QHash>
 #include <QMap>
 #include "application.h"
 #include "controller/signalmanager.h"
 
-class CacheThread : public QThread
-{
-    Q_OBJECT
-public:
-    explicit CacheThread(const QString &path)
-        : QThread(NULL)
-        , m_path(path) {}
-
-signals:
-    void cached(QString, QImage);
-
-protected:
-    void run() Q_DECL_OVERRIDE {
-        QImage img = utils::image::getRotatedImage(m_path);
-//        QImage img = dApp->m_imagemap.value(m_path).toImage();
-        qDebug() << "QImage img = utils::image::getRotatedImage(m_path)" << m_path;
-        emit cached(m_path, img);
-    }
-
-private:
-    QString m_path;
-};
-
 class SlideEffectPlayer : public QObject
 {
     Q_OBJECT
@@ -96,6 +75,16 @@ public:
     void cachePrevious();
     void setStartNextFlag(bool flag);
 
+private:
+    /**
+     * @brief startEffect 取出（或首次创建）对应种类的效果实例，重新设置参数后开始切换
+     */
+    bool startEffect(const EffectId &id, int duration, int allMs);
+    /**
+     * @brief releaseEffects 幻灯片结束时释放所有效果实例及其帧缓冲
+     */
+    void releaseEffects();
+
 private:
     bool m_running = false;
     bool m_pausing = false;
@@ -103,13 +92,16 @@ private:
     int m_tid;
     int m_newtid;
     int m_w, m_h;
-    QMap<QString, QImage> m_cacheImages;
+    //按屏幕尺寸解码、受内存预算限制的预读缓存
+    SlideImageCache m_cache;
     QStringList m_paths;
 //    QStringList::ConstIterator m_current;
     int m_current;
 
     QThread m_thread;
     SlideEffect *m_effect = nullptr;
+    //本次播放中复用的效果实例，每种效果一个
+    QHash<int, SlideEffect *> m_effects;
     bool b_4k = false;
     bool bfirstrun = true;
     bool bneedupdatepausebutton = false;
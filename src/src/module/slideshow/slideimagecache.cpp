@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "slideimagecache.h"
+#include "utils/imageutils.h"
+
+namespace {
+
+//解码线程数：当前图片和下一张可以同时解码
+const int DECODE_THREAD_COUNT = 2;
+
+} // namespace
+
+void SlideDecodeTask::run()
+{
+    QImage img = utils::image::loadScaledImage(m_path, m_size);
+    emit cached(m_path, img, m_generation);
+}
+
+SlideImageCache::SlideImageCache(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(DECODE_THREAD_COUNT);
+}
+
+SlideImageCache::~SlideImageCache()
+{
+    //先等解码任务结束，任务不会再向已销毁的对象发送结果
+    m_pool.clear();
+    m_pool.waitForDone();
+    clear();
+}
+
+void SlideImageCache::setDecodeSize(const QSize &size)
+{
+    if (m_decodeSize == size)
+        return;
+    m_decodeSize = size;
+    clear();
+}
+
+QSize SlideImageCache::decodeSize() const
+{
+    return m_decodeSize;
+}
+
+void SlideImageCache::setLookAhead(int count)
+{
+    m_lookAhead = qMax(1, count);
+}
+
+int SlideImageCache::lookAhead() const
+{
+    return m_lookAhead;
+}
+
+void SlideImageCache::setMemoryBudget(qint64 bytes)
+{
+    m_budget = qMax<qint64>(0, bytes);
+}
+
+qint64 SlideImageCache::memoryBudget() const
+{
+    return m_budget;
+}
+
+int SlideImageCache::effectiveLookAhead() const
+{
+    if (!m_decodeSize.isValid())
+        return m_lookAhead;
+    const qint64 imageBytes = qMax(qint64(m_decodeSize.width()) * m_decodeSize.height() * 4, m_imageBytes);
+    //当前图片和上一张必须保留，剩下的预算给后面的图片，至少预读一张
+    const qint64 images = imageBytes > 0 ? m_budget / imageBytes - 2 : m_lookAhead;
+    return int(qBound<qint64>(1, images, m_lookAhead));
+}
+
+void SlideImageCache::prefetch(const QStringList &paths, int current)
+{
+    if (paths.isEmpty() || current < 0 || current >= paths.size())
+        return;
+
+    const int count = paths.size();
+    const int ahead = qMin(effectiveLookAhead(), count - 1);
+    //解码顺序：当前、后面K张、上一张
+    QStringList order;
+    for (int i = 0; i <= ahead; i++) {
+        const QString &path = paths[(current + i) % count];
+        if (!order.contains(path))
+            order << path;
+    }
+    m_keep = order.mid(0, 2);
+    if (count > 1) {
+        const QString &previous = paths[(current - 1 + count) % count];
+        if (!order.contains(previous))
+            order << previous;
+        if (!m_keep.contains(previous))
+            m_keep << previous;
+    }
+
+    m_window = QSet<QString>::fromList(order);
+    m_order = order;
+    const QStringList cached = m_images.keys();
+    for (const QString &path : cached) {
+        if (!m_window.contains(path))
+            evict(path);
+    }
+
+    for (const QString &path : order) {
+        if (m_images.contains(path) || m_pending.contains(path))
+            continue;
+        m_pending.insert(path);
+        SlideDecodeTask *task = new SlideDecodeTask(path, m_decodeSize, m_generation);
+        connect(task, &SlideDecodeTask::cached, this, &SlideImageCache::onCached);
+        m_pool.start(task);
+    }
+}
+
+QImage SlideImageCache::load(const QString &path)
+{
+    if (m_images.contains(path))
+        return m_images.value(path);
+    QImage img = utils::image::loadScaledImage(path, m_decodeSize);
+    m_window.insert(path);
+    m_order.removeOne(path);
+    m_order.prepend(path);
+    if (!m_keep.contains(path))
+        m_keep.prepend(path);
+    insert(path, img);
+    return img;
+}
+
+QImage SlideImageCache::image(const QString &path) const
+{
+    return m_images.value(path);
+}
+
+bool SlideImageCache::contains(const QString &path) const
+{
+    return m_images.contains(path);
+}
+
+int SlideImageCache::count() const
+{
+    return m_images.size();
+}
+
+qint64 SlideImageCache::cachedBytes() const
+{
+    return m_bytes;
+}
+
+void SlideImageCache::clear()
+{
+    m_generation++;
+    //还没开始的解码直接丢弃，正在解码的结果按代数丢弃
+    m_pool.clear();
+    m_images.clear();
+    m_pending.clear();
+    m_window.clear();
+    m_order.clear();
+    m_keep.clear();
+    m_bytes = 0;
+    m_imageBytes = 0;
+}
+
+void SlideImageCache::onCached(const QString &path, const QImage &img, int generation)
+{
+    if (generation != m_generation)
+        return;
+    m_pending.remove(path);
+    //解码期间播放位置已经移走，结果直接丢弃
+    if (!m_window.contains(path))
+        return;
+    insert(path, img);
+}
+
+void SlideImageCache::insert(const QString &path, const QImage &img)
+{
+    evict(path);
+    m_images.insert(path, img);
+    m_bytes += img.sizeInBytes();
+    m_imageBytes = qMax<qint64>(m_imageBytes, img.sizeInBytes());
+    trimToBudget();
+}
+
+void SlideImageCache::trimToBudget()
+{
+    //实际解码出的图片可能比按解码尺寸估算的大，预读数量之外再按实际大小释放
+    const QStringList cached = m_images.keys();
+    for (const QString &path : cached) {
+        if (m_bytes <= m_budget)
+            return;
+        if (!m_order.contains(path))
+            evict(path);
+    }
+    //释放的图片移出窗口，之后的预读按实际大小缩小窗口，不会再次解码
+    for (int i = m_order.size() - 1; i >= 0 && m_bytes > m_budget; i--) {
+        const QString path = m_order.at(i);
+        if (m_keep.contains(path))
+            continue;
+        evict(path);
+        m_window.remove(path);
+        m_order.removeAt(i);
+    }
+}
+
+void SlideImageCache::evict(const QString &path)
+{
+    auto it = m_images.find(path);
+    if (it == m_images.end())
+        return;
+    m_bytes -= it->sizeInBytes();
+    m_images.erase(it);
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SLIDEIMAGECACHE_H
+#define SLIDEIMAGECACHE_H
+
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QRunnable>
+#include <QSet>
+#include <QSize>
+#include <QStringList>
+#include <QThreadPool>
+
+/*!
+  幻灯片图片的后台解码任务，在SlideImageCache自己的线程池中运行
+*/
+class SlideDecodeTask : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    explicit SlideDecodeTask(const QString &path, const QSize &size, int generation)
+        : m_path(path)
+        , m_size(size)
+        , m_generation(generation)
+    {
+        setAutoDelete(true);
+    }
+
+signals:
+    void cached(QString, QImage, int);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    QString m_path;
+    QSize m_size;
+    int m_generation;
+};
+
+/*!
+  幻灯片图片缓存。
+  图片直接按屏幕尺寸解码，只保留当前图片前一张和后K张，
+  缓存总大小受内存预算限制，窗口之外的图片随播放位置移动立即释放，
+  因此无论播放多少张图片内存占用都保持不变。
+  解码在固定线程数的线程池中进行，不为每张图片创建线程。
+*/
+class SlideImageCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SlideImageCache(QObject *parent = nullptr);
+    ~SlideImageCache() override;
+
+    /**
+     * @brief setDecodeSize 设置解码尺寸（设备像素），尺寸改变时清空已缓存的图片
+     */
+    void setDecodeSize(const QSize &size);
+    QSize decodeSize() const;
+    /**
+     * @brief setLookAhead 设置向后预读的图片数量
+     */
+    void setLookAhead(int count);
+    int lookAhead() const;
+    /**
+     * @brief setMemoryBudget 设置缓存可使用的最大字节数，超出时从离当前图片最远的开始释放，
+     * 当前、上一张和下一张（切换的两端）始终保留
+     */
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const;
+    /**
+     * @brief effectiveLookAhead 受内存预算限制后实际预读的图片数量，
+     * 按解码尺寸估算和已解码图片实际大小中较大的计算
+     */
+    int effectiveLookAhead() const;
+
+    /**
+     * @brief prefetch 以current为中心更新缓存窗口，释放窗口外的图片并解码窗口内缺少的图片
+     * @param paths 播放列表
+     * @param current 当前图片下标
+     */
+    void prefetch(const QStringList &paths, int current);
+    /**
+     * @brief load 同步解码并缓存一张图片，用于首次播放时的当前图片
+     */
+    QImage load(const QString &path);
+    QImage image(const QString &path) const;
+    bool contains(const QString &path) const;
+    int count() const;
+    qint64 cachedBytes() const;
+    void clear();
+
+private slots:
+    void onCached(const QString &path, const QImage &img, int generation);
+
+private:
+    void insert(const QString &path, const QImage &img);
+    void evict(const QString &path);
+    void trimToBudget();
+
+private:
+    QHash<QString, QImage> m_images;
+    QSet<QString> m_pending;
+    QSet<QString> m_window;
+    //窗口内图片的解码顺序：当前、后面K张、上一张，超出预算时从后往前释放
+    QStringList m_order;
+    //超出预算时也不释放的图片：当前、上一张和下一张
+    QStringList m_keep;
+    QThreadPool m_pool;
+    QSize m_decodeSize;
+    int m_lookAhead = 2;
+    qint64 m_budget = 256 * 1024 * 1024;
+    qint64 m_bytes = 0;
+    //已解码图片中最大的字节数，解码尺寸改变或清空时重新统计
+    qint64 m_imageBytes = 0;
+    //每次清空或改变解码尺寸后递增，之前发出的解码结果直接丢弃
+    int m_generation = 0;
+};
+
+#endif // SLIDEIMAGECACHE_H
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "slideregioncompositor.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+bool SlideRegionCompositor::sourceOffset(const QImage &frame, const QImage &source, const QRect &sourceRect, QPoint *offset)
+{
+    if (frame.isNull() || source.isNull() || frame.format() != source.format() || frame.depth() != 32) {
+        return false;
+    }
+    //与QPainter::drawImage一致，宽高不大于0时取到图片边缘
+    int sx = sourceRect.x();
+    int sy = sourceRect.y();
+    int sw = sourceRect.width() > 0 ? sourceRect.width() : source.width() - sx;
+    int sh = sourceRect.height() > 0 ? sourceRect.height() : source.height() - sy;
+    if (sw != frame.width() || sh != frame.height()) {
+        return false;
+    }
+    *offset = QPoint(sx, sy);
+    return true;
+}
+
+void SlideRegionCompositor::composite(QImage &frame, const QImage &source, const QPoint &offset, const QRegion &region)
+{
+    //源图之外的部分QPainter不会绘制，这里同样跳过
+    const QRect bounds = frame.rect() & source.rect().translated(-offset);
+    if (bounds.isEmpty()) {
+        return;
+    }
+    uchar *dstBits = frame.bits();
+    const int dstStride = frame.bytesPerLine();
+    const uchar *srcBits = source.constBits();
+    const int srcStride = source.bytesPerLine();
+
+    for (const QRect &r : region) {
+        const QRect rect = r & bounds;
+        if (rect.isEmpty()) {
+            continue;
+        }
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            quint32 *dst = reinterpret_cast<quint32 *>(dstBits + y * dstStride) + rect.left();
+            const quint32 *src = reinterpret_cast<const quint32 *>(srcBits + (y + offset.y()) * srcStride)
+                                 + rect.left() + offset.x();
+            blitRow(dst, src, rect.width());
+        }
+    }
+}
+
+void SlideRegionCompositor::clear(QImage &frame, const QRegion &region)
+{
+    uchar *bits = frame.bits();
+    const int stride = frame.bytesPerLine();
+    for (const QRect &r : region) {
+        const QRect rect = r & frame.rect();
+        if (rect.isEmpty()) {
+            continue;
+        }
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            memset(bits + y * stride + rect.left() * 4, 0, static_cast<size_t>(rect.width()) * 4);
+        }
+    }
+}
+
+void SlideRegionCompositor::blitRow(quint32 *dst, const quint32 *src, int count)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 4));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 12));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), a);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 4), b);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8), c);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 12), d);
+    }
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                         _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; i + 16 <= count; i += 16) {
+        uint32x4_t a = vld1q_u32(src + i);
+        uint32x4_t b = vld1q_u32(src + i + 4);
+        uint32x4_t c = vld1q_u32(src + i + 8);
+        uint32x4_t d = vld1q_u32(src + i + 12);
+        vst1q_u32(dst + i, a);
+        vst1q_u32(dst + i + 4, b);
+        vst1q_u32(dst + i + 8, c);
+        vst1q_u32(dst + i + 12, d);
+    }
+    for (; i + 4 <= count; i += 4) {
+        vst1q_u32(dst + i, vld1q_u32(src + i));
+    }
+#endif
+    //剩余像素以及其它架构
+    if (i < count) {
+        memcpy(dst + i, src + i, static_cast<size_t>(count - i) * sizeof(quint32));
+    }
+}
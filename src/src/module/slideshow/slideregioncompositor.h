@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SLIDEREGIONCOMPOSITOR_H
+#define SLIDEREGIONCOMPOSITOR_H
+
+#include <QImage>
+#include <QRegion>
+
+/*!
+  幻灯片切换效果的区域合成器。
+  切换效果的裁剪区域都由矩形组成（百叶窗、开合、推入为若干矩形，椭圆为逐行的矩形带），
+  源图与帧大小相同时只是整数平移，可以按行直接拷贝像素，代替QPainter的裁剪绘制。
+*/
+class SlideRegionCompositor
+{
+public:
+    /*!
+        计算源图在帧中的整数平移量，源矩形为空时与QPainter::drawImage一样取整张图。
+        格式不一致、不是32位像素或需要缩放时返回false，调用方应回退到QPainter绘制
+    */
+    static bool sourceOffset(const QImage &frame, const QImage &source, const QRect &sourceRect, QPoint *offset);
+
+    /*!
+        将源图中region范围内的像素拷贝到帧中，region之外以及源图之外的像素保持不变
+    */
+    static void composite(QImage &frame, const QImage &source, const QPoint &offset, const QRegion &region);
+
+    /*!
+        将region范围内的像素清为透明
+    */
+    static void clear(QImage &frame, const QRegion &region);
+
+    /*!
+        按行拷贝count个32位像素，SSE2/NEON下每次处理16个像素
+    */
+    static void blitRow(quint32 *dst, const quint32 *src, int count);
+};
+
+#endif // SLIDEREGIONCOMPOSITOR_H
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "sliderenderpool.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QThread>
+
+namespace {
+
+//渲染线程数，与之前全局线程池的设置一致
+const int RENDER_THREAD_COUNT = 3;
+//同时在渲染中的最大帧数，与切换效果的环形帧缓冲大小一致
+const int RENDER_MAX_IN_FLIGHT = 4;
+
+} // namespace
+
+SlideRenderPool *SlideRenderPool::instance()
+{
+    //缩略图加载线程也会调用，局部静态变量保证只构造一次
+    static SlideRenderPool *pool = new SlideRenderPool;
+    return pool;
+}
+
+SlideRenderPool::SlideRenderPool(QObject *parent)
+    : QObject(parent)
+    , m_maxInFlight(RENDER_MAX_IN_FLIGHT)
+{
+    m_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() - 1, RENDER_THREAD_COUNT));
+    //渲染线程空闲一段时间后退出，不常驻
+    m_pool.setExpiryTimeout(5000);
+}
+
+bool SlideRenderPool::tryStart(QRunnable *task)
+{
+    int current = m_inFlight.loadAcquire();
+    do {
+        if (current >= m_maxInFlight)
+            return false;
+    } while (!m_inFlight.testAndSetOrdered(current, current + 1, current));
+    m_pool.start(task);
+    return true;
+}
+
+void SlideRenderPool::taskFinished()
+{
+    m_inFlight.fetchAndAddOrdered(-1);
+    emit capacityAvailable();
+}
+
+bool SlideRenderPool::hasCapacity() const
+{
+    return m_inFlight.loadAcquire() < m_maxInFlight;
+}
+
+int SlideRenderPool::inFlight() const
+{
+    return m_inFlight.loadAcquire();
+}
+
+int SlideRenderPool::maxInFlight() const
+{
+    return m_maxInFlight;
+}
+
+void SlideRenderPool::beginTransition()
+{
+    QMutexLocker locker(&m_mutex);
+    m_transitions++;
+}
+
+void SlideRenderPool::endTransition()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_transitions > 0 && --m_transitions == 0) {
+        m_transitionEnded.wakeAll();
+    }
+}
+
+bool SlideRenderPool::isTransitionActive() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_transitions > 0;
+}
+
+void SlideRenderPool::yieldToTransition(int maxMs)
+{
+    QMutexLocker locker(&m_mutex);
+    QElapsedTimer timer;
+    timer.start();
+    while (m_transitions > 0) {
+        const qint64 left = maxMs - timer.elapsed();
+        if (left <= 0)
+            break;
+        m_transitionEnded.wait(&m_mutex, static_cast<unsigned long>(left));
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SLIDERENDERPOOL_H
+#define SLIDERENDERPOOL_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+/*!
+  幻灯片帧渲染专用线程池。
+  不修改全局线程池，同时在渲染中的帧数有上限，超过上限时提交失败，
+  由切换效果在capacityAvailable之后重新提交；
+  切换进行期间后台缩略图加载调用yieldToTransition让出CPU。
+*/
+class SlideRenderPool : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief instance 需在界面线程先调用一次，使对象属于界面线程
+     */
+    static SlideRenderPool *instance();
+
+    /**
+     * @brief tryStart 提交一帧渲染任务，渲染中的帧数已达上限时返回false，任务不会被执行
+     */
+    bool tryStart(QRunnable *task);
+    /**
+     * @brief taskFinished 渲染任务结束时调用，无论是否被取消
+     */
+    void taskFinished();
+    bool hasCapacity() const;
+    int inFlight() const;
+    int maxInFlight() const;
+
+    /**
+     * @brief beginTransition 切换开始，之后的后台缩略图加载会等待切换结束
+     */
+    void beginTransition();
+    void endTransition();
+    bool isTransitionActive() const;
+    /**
+     * @brief yieldToTransition 切换进行中时阻塞等待其结束，最多等待maxMs毫秒
+     */
+    void yieldToTransition(int maxMs = 1000);
+
+signals:
+    void capacityAvailable();
+
+private:
+    explicit SlideRenderPool(QObject *parent = nullptr);
+
+private:
+    QThreadPool m_pool;
+    QAtomicInt m_inFlight;
+    int m_maxInFlight;
+    mutable QMutex m_mutex;
+    QWaitCondition m_transitionEnded;
+    int m_transitions = 0;
+};
+
+#endif // SLIDERENDERPOOL_H
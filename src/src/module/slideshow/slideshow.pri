@@ -1,6 +1,9 @@
 HEADERS += \
     $$PWD/slideeffect.h \
     $$PWD/slideeffectplayer.h \
+    $$PWD/slideimagecache.h \
+    $$PWD/slideregioncompositor.h \
+    $$PWD/sliderenderpool.h \
     $$PWD/slideshowpanel.h \
     $$PWD/slideshowbottombar.h
 
@@ -9,8 +12,11 @@ SOURCES += \
     $$PWD/slideeffect_blinds.cpp \
     $$PWD/slideeffect_enter.cpp \
     $$PWD/slideeffectplayer.cpp \
+    $$PWD/slideimagecache.cpp \
     $$PWD/slideeffect_tile.cpp \
     $$PWD/slideshowpanel.cpp \
     $$PWD/slideeffect_switcher.cpp \
     $$PWD/slideeffect_circle.cpp \
+    $$PWD/slideregioncompositor.cpp \
+    $$PWD/sliderenderpool.cpp \
     $$PWD/slideshowbottombar.cpp
@@ -18,6 +18,7 @@
 #include "application.h"
 #include "controller/signalmanager.h"
 #include "utils/imageutils.h"
+#include "utils/metadatareader.h"
 #include "widgets/formlabel.h"
 #include "accessibility/ac-desktop-define.h"
 
@@ -36,6 +37,7 @@
 #include <QScrollBar>
 #include <QString>
 #include <QtDebug>
+#include <QtConcurrent>
 #include <QPainterPath>
 
 
@@ -168,6 +170,8 @@ ImageInfoWidget::ImageInfoWidget(const QString &darkStyle, const QString &lightS
 #endif
     Q_UNUSED(darkStyle);
     Q_UNUSED(lightStyle);
+    connect(&m_metaWatcher, &QFutureWatcher<QMap<QString, QString>>::finished,
+            this, &ImageInfoWidget::onMetaDataLoaded);
     setFixedWidth(300);
     //    setMaximumHeight(540);
     setFrameStyle(QFrame::NoFrame);
@@ -264,10 +268,31 @@ void ImageInfoWidget::setImagePath(const QString path)
         return;
 
     m_path = path;
+    m_metaData.clear();
     m_isBaseInfo = false;
     m_isDetailsInfo = false;
     updateInfo();
+    updateExpand();
 
+    //只读取文件头，在线程中完成后再填充，不阻塞界面线程
+    m_metaWatcher.setFuture(QtConcurrent::run([path] {
+        return QMap<QString, QString>(utils::image::readMetaData(path));
+    }));
+}
+
+void ImageInfoWidget::onMetaDataLoaded()
+{
+    if (m_metaWatcher.isCanceled())
+        return;
+    m_metaData = m_metaWatcher.result();
+    m_isBaseInfo = false;
+    m_isDetailsInfo = false;
+    updateInfo();
+    updateExpand();
+}
+
+void ImageInfoWidget::updateExpand()
+{
     QStringList titleList;
     //    QVBoxLayout *layout = qobject_cast<QVBoxLayout *>(m_scrollArea->widget()->layout());
     QVBoxLayout *layout = qobject_cast<QVBoxLayout *>(this->layout());
@@ -374,7 +399,7 @@ void ImageInfoWidget::updateInfo()
 {
     using namespace utils::image;
     using namespace utils::base;
-    auto mds = getAllMetaData(m_path);
+    const QMap<QString, QString> &mds = m_metaData;
     // Minus layout margins
     //    m_maxFieldWidth = width() - m_maxTitleWidth - 20*2;
     //solve bug 1623 根据中英文系统语言设置Title宽度  shuwenzhi   20200313
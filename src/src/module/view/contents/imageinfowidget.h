@@ -21,6 +21,8 @@
 #include "widgets/themewidget.h"
 
 #include <QWidget>
+#include <QFutureWatcher>
+#include <QMap>
 #include <QLabel>
 #include <QScrollArea>
 #include <QVector>
@@ -50,6 +52,12 @@ public:
 public slots:
 //    void onExpandChanged(const bool &e);
 
+private slots:
+    /**
+     * @brief onMetaDataLoaded 线程中读取的元数据返回后填充信息面板
+     */
+    void onMetaDataLoaded();
+
 protected:
     void resizeEvent(QResizeEvent *e) Q_DECL_OVERRIDE;
     void timerEvent(QTimerEvent *e) Q_DECL_OVERRIDE;
@@ -59,6 +67,10 @@ private:
     const QString trLabel(const char *str);
     void updateBaseInfo(const QMap<QString, QString> &infos, bool CNflag);
     void updateDetailsInfo(const QMap<QString, QString> &infos, bool CNflag);
+    /**
+     * @brief updateExpand 按是否有基本信息、详细信息重建展开栏
+     */
+    void updateExpand();
     QList<DDrawer *> addExpandWidget(const QStringList &titleList);
     void initExpand(QVBoxLayout *layout, DDrawer *expand);
 
@@ -79,6 +91,9 @@ private:
     QVBoxLayout *m_mainLayout = nullptr;
     QScrollArea *m_scrollArea = nullptr;
     QString m_closedString;
+    //当前图片的元数据，在线程中只读取文件头得到
+    QMap<QString, QString> m_metaData;
+    QFutureWatcher<QMap<QString, QString>> m_metaWatcher;
 };
 
 #endif // IMAGEINFOWIDGET_H
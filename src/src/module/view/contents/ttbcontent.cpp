@@ -67,9 +67,24 @@ const int TOOLBAR_DVALUE = 114 + 8;
 
 const int THUMBNAIL_WIDTH = 32;
 const int THUMBNAIL_ADD_WIDTH = 32;
+const QSize THUMBNAIL_ITEM_SIZE = QSize(32, 40);
+const QSize THUMBNAIL_CURRENT_SIZE = QSize(58, 58);
+//可见区域两侧额外保留的图元个数，避免快速拖动时露出空白
+const int THUMBNAIL_VISIBLE_MARGIN = 8;
 const int THUMBNAIL_LIST_ADJUST = 9 + 5;
 const int THUMBNAIL_VIEW_DVALUE = 496 + 10;
 
+//占位图标按资源路径缓存，明暗主题使用不同的路径，各自只加载一次
+const QIcon &placeholderIcon(const QString &path)
+{
+    static QHash<QString, QIcon> icons;
+    QHash<QString, QIcon>::iterator it = icons.find(path);
+    if (it == icons.end()) {
+        it = icons.insert(path, QIcon(path));
+    }
+    return it.value();
+}
+
 const unsigned int IMAGE_TYPE_JEPG = 0xFFD8FF;
 const unsigned int IMAGE_TYPE_JPG1 = 0xFFD8FFE0;
 const unsigned int IMAGE_TYPE_JPG2 = 0xFFD8FFE1;
@@ -182,8 +197,8 @@ bool MyImageListWidget::UpdateThumbnail()
         m_iRet=false;
         dApp->m_bMove=false;
         bmouseleftpressed = false;
-        if(m_currentImageItem){
-            m_currentImageItem->emitClickEndSig();
+        if (m_centeredIndex >= 0) {
+            emit centerItemReleased(m_centeredIndex);
         }
         m_vecPoint.clear();
         m_lastPoint=QPoint(0,0);
@@ -240,94 +255,28 @@ bool MyImageListWidget::UpdateThumbnail()
         animation->setKeyValueAt(1, QPoint(((DWidget *)m_obj)->x()+300, ((DWidget *)m_obj)->y()));
         //            animation->setEndValue(QPoint(((DWidget *)m_obj)->x()+300, ((DWidget *)m_obj)->y()));
     }
-    connect(animation, &QPropertyAnimation::finished, [=]{
-        m_iRet=false;
-        dApp->m_bMove=false;
-        bmouseleftpressed = false;
-        m_vecPoint.clear();
-        //lmh0915,加上延时100ms，为了防止动画完了，还在跳转
-        QTimer::singleShot(100,[=]{
-            if(m_currentImageItem){
-                m_currentImageItem->emitClickEndSig();
-            }
-        });
-
-        m_lastPoint=QPoint(0,0);
-        emit mouseLeftReleased();
-    });
-    qDebug()<<"left1:"<<this->geometry().left();
-    qDebug()<<"right2:"<<this->geometry().right();
     int indexTotal=((this->geometry().right()-this->geometry().left())/64)-1;
     qDebug()<<indexTotal;
-    /*lmh0727*/
-    QThread *th = QThread::create([=]() {
-        if(m_bthreadMutex){
-            return;
-        }
-        m_bthreadMutex=true;
-        QMutexLocker locker(&m_threadMutex);
-        while(m_iRet &&dApp->m_bMove)
-        {
-            QThread::msleep(50);
-            /*lmh0727*/
-
-            QObjectList list = dynamic_cast<DWidget *>(m_obj)->children();
-            int middle = (this->geometry().left() + this->geometry().right()) / 2;
-            int listLeft = dynamic_cast<DWidget *>(m_obj)->geometry().left();
-
-            if(list.size()>2){
-                for (int i = 2; i < list.size(); i++) {
-                    ImageItem *img=dynamic_cast<ImageItem *>(list.at(i));
-                    if (nullptr == img) {
-                        continue;
-                    }
-                    bool bMiddel=true;
-                    for(int j=0;j<indexTotal;++j){
-                        if(list.at(list.size()-j-1)==m_currentImageItem||list.at(2+j)==m_currentImageItem)
-                        {
-                            bMiddel=false;
-                            break;
-                        }
-                    }
-                    if(bMiddel)
-                    {
-                        int left = this->geometry().left() + img->geometry().left() + listLeft;
-                        int right = this->geometry().left() + img->geometry().right() + listLeft;
-                        if (left <= middle && middle < right) {
-                            //lmh0915快速向中间加载
-//                            if(img->getIndexNow()-(i-2)>1)
-//                            {
-//                                ImageItem *img2=dynamic_cast<ImageItem *>(list.at(img->getIndexNow()+1));
-//                                img2->emitClickSig(img2->getPath());
-//                                m_currentImageItem=img2;
-//                            }
-//                            else if(img->getIndexNow()-(i-2)<-1)
-//                            {
-//                                ImageItem *img2=dynamic_cast<ImageItem *>(list.at(img->getIndexNow()+3));
-//                                img2->emitClickSig(img2->getPath());
-//                                m_currentImageItem=img2;
-//                            }
-//                            else {
-                                img->emitClickSig(img->getPath());
-                                m_currentImageItem=img;
-//                            }
-                            break;
-                        }
-                    }
-                }
-            }
+    //动画每一帧移动缩略图栏之后，在GUI线程按索引计算中线下的图元
+    connect(animation, &QPropertyAnimation::valueChanged, this, [=]{
+        if (m_iRet && dApp->m_bMove) {
+            selectMiddleItem(indexTotal);
         }
+    });
+    connect(animation, &QPropertyAnimation::finished, this, [=]{
+        selectMiddleItem(indexTotal);
         m_iRet=false;
         dApp->m_bMove=false;
         bmouseleftpressed = false;
         m_vecPoint.clear();
-        if(m_currentImageItem){
-            m_currentImageItem->emitClickEndSig();
+        //动画停止时确认选中项
+        if (m_centeredIndex >= 0) {
+            emit centerItemReleased(m_centeredIndex);
         }
-        m_bthreadMutex=false;
+
+        m_lastPoint=QPoint(0,0);
+        emit mouseLeftReleased();
     });
-    connect(th, &QThread::finished, th, &QObject::deleteLater);
-    th->start();
     animation->start(QAbstractAnimation::DeleteWhenStopped);
     return true;
 }
@@ -338,6 +287,7 @@ bool MyImageListWidget::eventFilter(QObject *obj, QEvent *e)
 
     if (e->type() == QEvent::MouseButtonPress) {
         bmouseleftpressed = true;
+        m_centeredIndex = -1;
         QMouseEvent *mouseEvent = (QMouseEvent *)e;
         m_prepoint = mouseEvent->globalPos();
         qDebug() << "m_prepoint:" << m_prepoint;
@@ -404,85 +354,64 @@ bool MyImageListWidget::eventFilter(QObject *obj, QEvent *e)
         if(m_lastPoint==QPoint(0,0)){
             m_lastPoint=CurrentcoursePoint;
         }
-        bool bleft=true;
         if((CurrentcoursePoint.x()-m_lastPoint.x())<15 &&(CurrentcoursePoint.x()-m_lastPoint.x())>-15  /*||(CurrentcoursePoint.x()-m_lastPoint.x())>64 ||(CurrentcoursePoint.x()-m_lastPoint.x())<-64*/)
         {
             return false;
         }
-        if(CurrentcoursePoint.x()-m_lastPoint.x()<0){
-            bleft=true;
-        }
-        else {
-            bleft=false;
-        }
         m_lastPoint=CurrentcoursePoint;
         /*lmh0727*/
 
-        QObjectList list = dynamic_cast<DWidget *>(m_obj)->children();
-        int middle = (this->geometry().left() + this->geometry().right()) / 2;
-        int listLeft = dynamic_cast<DWidget *>(m_obj)->geometry().left();
-        if(list.size()>2){
-            for (int i = 2; i < list.size(); i++) {
-                ImageItem *img=dynamic_cast<ImageItem *>(list.at(i));
-                if (nullptr == img) {
-                    continue;
-                }
-                if(m_currentImageItem==nullptr){
-                    ImageItem *img=dynamic_cast<ImageItem *>(list.at(i));
-                    qDebug()<<img->getIndexNow();
-                    if(img->getIndexNow()==i-2)
-                    {
-                        m_currentImageItem=img;
-                    }
-                }
-                /*对于末尾的情况和排头的情况，特殊处理*/
-                if((/*list.at(3)==m_currentImageItem ||*/list.at(2)==m_currentImageItem )&&!bleft){
-                    ImageItem *img2=dynamic_cast<ImageItem *>(list.at(2));
-                    int left = this->geometry().left() + img2->geometry().left() + listLeft;
-//                    qDebug()<<"left "<<left<<"middle "<<middle;
-                    if (left > middle+32 ){
-                        img2->emitClickSig(img2->getPath());
-                        m_currentImageItem=img2;
-                    }
-                }
-                if((list.at(list.size()-1)==m_currentImageItem /*||list.at(list.size()-2)==m_currentImageItem*/) &&bleft){
-                    ImageItem *img2=dynamic_cast<ImageItem *>(list.at(list.size()-1));
-                    int right = this->geometry().left() + img2->geometry().right() + listLeft;
-                    if (middle > right+32 ){
-                        img2->emitClickSig(img2->getPath());
-                        m_currentImageItem=img2;
-                    }
-                }
-                if(img != m_currentImageItem) {
-                    int left = this->geometry().left() + img->geometry().left() + listLeft;
-                    int right = this->geometry().left() + img->geometry().right() + listLeft;
-                    if (left <= middle && middle < right) {
-                        //一个一个朝向中间加载
-//                        if(img->getIndexNow()-(i-2)>1)
-//                        {
-//                            ImageItem *img2=dynamic_cast<ImageItem *>(list.at(img->getIndexNow()+1));
-//                            img2->emitClickSig(img2->getPath());
-//                            m_currentImageItem=img2;
-//                        }
-//                        else if(img->getIndexNow()-(i-2)<-1)
-//                        {
-//                            ImageItem *img2=dynamic_cast<ImageItem *>(list.at(img->getIndexNow()+3));
-//                            img2->emitClickSig(img2->getPath());
-//                            m_currentImageItem=img2;
-//                        }
-//                        else {
-                            img->emitClickSig(img->getPath());
-                            m_currentImageItem=img;
-//                        }
-                        break;
-                    }
-                }
-            }
-        }
+        selectMiddleItem(0);
     }
     return false;
 }
 
+void MyImageListWidget::setItemCount(int count)
+{
+    m_itemCount = count;
+}
+
+void MyImageListWidget::setCurrentIndex(int index)
+{
+    m_selectedIndex = index;
+}
+
+int MyImageListWidget::indexAtMiddle() const
+{
+    DWidget *list = static_cast<DWidget *>(m_obj);
+    if (!list || m_itemCount <= 0) {
+        return -1;
+    }
+    //图元宽32，选中项宽58，选中项之后的图元整体右移
+    int middle = width() / 2 - list->x();
+    int selectedLeft = m_selectedIndex * THUMBNAIL_WIDTH;
+    int index = -1;
+    if (middle < 0) {
+        return -1;
+    } else if (m_selectedIndex < 0 || middle < selectedLeft) {
+        index = middle / THUMBNAIL_WIDTH;
+    } else if (middle < selectedLeft + THUMBNAIL_CURRENT_SIZE.width()) {
+        index = m_selectedIndex;
+    } else {
+        index = (middle - THUMBNAIL_CURRENT_SIZE.width() + THUMBNAIL_WIDTH) / THUMBNAIL_WIDTH;
+    }
+    return index < m_itemCount ? index : -1;
+}
+
+void MyImageListWidget::selectMiddleItem(int edgeCount)
+{
+    int index = indexAtMiddle();
+    if (index < 0 || index == m_selectedIndex) {
+        return;
+    }
+    //首尾edgeCount个图元无法居中，当前项处于首尾时不随动画切换
+    if (m_selectedIndex < edgeCount || m_selectedIndex >= m_itemCount - edgeCount) {
+        return;
+    }
+    m_centeredIndex = index;
+    emit itemCentered(index);
+}
+
 ImageItem::ImageItem(int index, QString path, char *imageType, QWidget *parent)
     :DLabel(parent)
 {
@@ -506,6 +435,17 @@ ImageItem::ImageItem(int index, QString path, char *imageType, QWidget *parent)
     });
 }
 
+void ImageItem::reuse(int index, const QString &path)
+{
+    _index = index;
+    _path = path;
+    setObjectName(path);
+    _pixmap = dApp->m_imagemap.value(path);
+    //已经加载过但没有缩略图的视为损坏图片
+    bFirstUpdate = !dApp->m_imagemap.contains(path);
+    update();
+}
+
 void ImageItem::emitClickSig(QString path)
 {
     emit imageMoveclicked(path);
@@ -520,16 +460,42 @@ void ImageItem::paintEvent(QPaintEvent *event)
 {
     Q_UNUSED(event);
     DGuiApplicationHelper::ColorType themeType = DGuiApplicationHelper::instance()->themeType();
+    bool selected = (_index == _indexNow || 58 == this->size().width());
+    QRgb highlight = DGuiApplicationHelper::instance()->applicationPalette().highlight().color().rgba();
+    qreal ratio = devicePixelRatioF();
+
+    //只有缩略图、尺寸、选中状态或主题变化时才重新绘制，拖动缩略图栏时直接贴图
+    if (m_renderCache.isNull() || m_renderPixmapKey != _pixmap.cacheKey() || m_renderSize != size()
+            || !qFuzzyCompare(m_renderRatio, ratio) || m_renderSelected != selected
+            || m_renderFirstUpdate != bFirstUpdate || m_renderHighlight != highlight
+            || m_renderTheme != themeType) {
+        m_renderPixmapKey = _pixmap.cacheKey();
+        m_renderSize = size();
+        m_renderRatio = ratio;
+        m_renderSelected = selected;
+        m_renderFirstUpdate = bFirstUpdate;
+        m_renderHighlight = highlight;
+        m_renderTheme = themeType;
+        renderThumbnail(selected, themeType);
+    }
 
     QPainter painter(this);
+    painter.drawPixmap(0, 0, m_renderCache);
+}
+
+void ImageItem::renderThumbnail(bool selected, DGuiApplicationHelper::ColorType themeType)
+{
+    m_renderCache = QPixmap(size() * m_renderRatio);
+    m_renderCache.setDevicePixelRatio(m_renderRatio);
+    m_renderCache.fill(Qt::transparent);
+
+    QPainter painter(&m_renderCache);
 
     painter.setRenderHints(QPainter::HighQualityAntialiasing | QPainter::SmoothPixmapTransform |
                            QPainter::Antialiasing);
     QRect backgroundRect = rect();
     QRect pixmapRect;
-    QFileInfo fileinfo(_path);
-    QString str = fileinfo.suffix();
-    if (_index == _indexNow ||58==this->size().width()) {
+    if (selected) {
         QPainterPath backgroundBp;
         QRect reduceRect = QRect(backgroundRect.x() + 1, backgroundRect.y() + 1,
                                  backgroundRect.width() - 2, backgroundRect.height() - 2);
@@ -581,8 +547,7 @@ void ImageItem::paintEvent(QPaintEvent *event)
         if (_pixmap.isNull()) {
             painter.setClipPath(bg);
             //            painter.drawPixmap(pixmapRect, m_pixmapstring);
-            QIcon icon(m_pixmapstring);
-            icon.paint(&painter, pixmapRect);
+            placeholderIcon(m_pixmapstring).paint(&painter, pixmapRect);
         }
     } else {
         pixmapRect.setX(backgroundRect.x() + 1);
@@ -616,8 +581,7 @@ void ImageItem::paintEvent(QPaintEvent *event)
             painter.setClipPath(bg);
             //            painter.drawPixmap(pixmapRect, m_pixmapstring);
 
-            QIcon icon(m_pixmapstring);
-            icon.paint(&painter, pixmapRect);
+            placeholderIcon(m_pixmapstring).paint(&painter, pixmapRect);
         }
     }
     //    QPixmap blankPix = _pixmap;
@@ -772,19 +736,9 @@ void TTBContent::initBtn()
     }
 
     m_imgList->setEnabled(true);
-    m_imglayout = new QHBoxLayout();
-    m_imglayout->setAlignment(Qt::AlignLeft | Qt::AlignTop);
-    //    m_imglayout->setMargin(0);
-    m_imglayout->setContentsMargins(0, 1, 0, 0);
-    m_imglayout->setSpacing(0);
-//LMH0605
-    DLabel *pLabel=new DLabel (this);
-    pLabel->setMaximumSize(QSize(0,58));
-    pLabel->setFixedSize(QSize(0,58));
-    pLabel->resize(QSize(0,58));
-    m_imglayout->addWidget(pLabel);
-
-    m_imgList->setLayout(m_imglayout);
+    //图元不使用布局，由updateVisibleItems按索引定位，拖动和动画移动时刷新可见图元
+    m_imgList->installEventFilter(this);
+    m_imgListView->installEventFilter(this);
 
     if (m_imgInfos.size() <= 3) {
         m_imgListView->setFixedSize(QSize(TOOLBAR_DVALUE, TOOLBAR_HEIGHT));
@@ -848,6 +802,19 @@ void TTBContent::initBtn()
 void TTBContent::toolbarSigConnection()
 {
     //拖动后移动多少
+    //拖动或滑动时中线下的图元由缩略图栏按索引计算，这里转成图元的点击信号
+    connect(m_imgListView, &MyImageListWidget::itemCentered, this, [ = ](int index) {
+        ImageItem *item = m_visibleItems.value(index);
+        if (item) {
+            item->emitClickSig(item->getPath());
+        }
+    });
+    connect(m_imgListView, &MyImageListWidget::centerItemReleased, this, [ = ](int index) {
+        ImageItem *item = m_visibleItems.value(index);
+        if (item) {
+            item->emitClickEndSig();
+        }
+    });
     connect(m_imgListView, &MyImageListWidget::mouseLeftReleased, this, [ = ] {
         int movex = m_imgList->x();
         if (movex > 0)
@@ -1083,11 +1050,13 @@ void TTBContent::OnSetimglist(int currindex, QString filename, QString filepath)
 
 void TTBContent::OnChangeItemPath(int currindex, QString path)
 {
-    QList<ImageItem *> labelList = m_imgList->findChildren<ImageItem *>();
-    if(labelList.count() == 0) return;
-    ImageItem *item = labelList.at(currindex);
+    //不可见的图元复用时会从m_imgInfos取到新路径
+    ImageItem *item = m_visibleItems.value(currindex);
+    if(!item) return;
+    m_pathItems.remove(item->getPath());
     item->SetPath(path);
     item->setObjectName(path);
+    m_pathItems.insert(path, item);
 }
 
 //void TTBContent::updateFilenameLayout()
@@ -1135,46 +1104,22 @@ void TTBContent::OnChangeItemPath(int currindex, QString path)
 //修改返回，改为一处返回，复合标准，修复cppcheck style问题
 bool TTBContent::delPictureFromPath(QString strPath, DBImgInfoList infos, int nCurrent)
 {
-    bool bRet = true;
-    ImageItem *test = m_imgList->findChild<ImageItem *>(strPath);
-    if (!test) {
-        bRet = false;
-    }else {
-        //qDebug() << "被删除的图片路径：" << test->objectName();
-        m_imglayout->removeWidget(test);
-        test->setParent(nullptr);
-        test->deleteLater();
+    bool bRet = false;
+    foreach (DBImgInfo var, m_imgInfos) {
+        if (var.filePath == strPath) {
+            bRet = true;
+            break;
+        }
+    }
 
+    if (bRet) {
+        //删除之后其后的图片索引都会减一，回收全部图元后按新索引重新生成
+        clearItems();
         m_imgInfos = infos;
         m_nowIndex = nCurrent;
-        //删除当前图片之后将当前图片和之后的所有图片index减一
-        int i = 0;
-        foreach (DBImgInfo var, m_imgInfos) {
-            ImageItem *test = m_imgList->findChild<ImageItem *>(var.filePath);
-            if (test) {
-                test->setIndex(i);
-            }
-
-            i++;
-        }
 
-        //    QList<ImageItem *> labelList = m_imgList->findChildren<ImageItem *>();
-        //    if (nCurrent != 0) {
-        //        for (int i = nCurrent; i < labelList.size(); i++) {
-        //            labelList.at(i)->setIndex(i);
-        //        }
-        //    } else {
-        //        for (int i = 0; i < labelList.size(); i++) {
-        //            labelList.at(i)->setIndex(i);
-        //        }
-        //    }
-        //    //将所有的NowIndex重置
-        //    for (int i = 0; i < labelList.size(); i++) {
-        //        labelList.at(i)->setIndexNow(nCurrent);
-        //    }
-
-        m_imgList->adjustSize();
         onResize();
+        updateVisibleItems();
     }
 
     return bRet;
@@ -1212,13 +1157,7 @@ bool TTBContent::judgeReloadItem(const DBImgInfoList &inputInfos, DBImgInfoList
     if (inputInfos.size() != localInfos.size()) {
         localInfos.clear();
         localInfos = inputInfos;
-
-        QLayoutItem *child;
-        while ((child = m_imglayout->takeAt(0)) != nullptr) {
-            m_imglayout->removeWidget(child->widget());
-            child->widget()->setParent(nullptr);
-            delete child;
-        }
+        clearItems();
 
         bRet = true;
     }
@@ -1229,77 +1168,14 @@ bool TTBContent::judgeReloadItem(const DBImgInfoList &inputInfos, DBImgInfoList
 void TTBContent::reloadItems(DBImgInfoList &inputInfos, QString strCurPath)
 {
     int i = 0;
-    int num = 32;
     int t = 0;
-    QList<ImageItem *> labelList = m_imgList->findChildren<ImageItem *>();
-
     for (DBImgInfo info : inputInfos) {
-        if (labelList.size() != inputInfos.size()) {
-            //char *imageType = getImageType(info.filePath);
-            ImageItem *imageItem = new ImageItem(i, info.filePath, nullptr);
-            imageItem->setFixedSize(QSize(32, 40));
-            imageItem->resize(QSize(32, 40));
-            imageItem->installEventFilter(m_imgListView);
-            imageItem->setObjectName(info.filePath);
-            /*LMH0727*/
-           // imageItem->setObjectName(QString("%1").arg(m_totalImageItem++));
-            m_imglayout->addWidget(imageItem);
-            connect(imageItem, &ImageItem::imageMoveclicked, this,
-            [ = ](QString path) {
-                m_bMoving=false;
-                if(dApp->m_bMove){
-                    m_lastIndex=m_nowIndex;
-                    QList <ImageItem *>labelList=m_imgList->findChildren<ImageItem *>(path);
-                    if(labelList.size()>0){
-                        ImageItem *img =labelList.at(0);
-                        if(nullptr !=img){
-                            img->setIndexNow(m_nowIndex);
-                            labelList.at(0)->setFixedSize(QSize(58,58));
-                            labelList.at(0)->resize(QSize(58,58));
-                            QPixmap pix=img->getPixmap();
-                            m_nowIndex=img->getIndex();
-                            emit showvaguepixmap(pix,labelList.at(0)->getPath());
-                            emit sigsetcurrent(labelList.at(0)->getPath());
-                        }
-                    }
-                    if(m_lastIndex >-1){
-                        QList <ImageItem *>lastlabelList=m_imgList->findChildren<ImageItem *>(/*QString("%1").arg(m_lastIndex)*/);
-                        if(lastlabelList.isEmpty()){
-                        }
-                        else {
-                            for(int i=0;i<lastlabelList.size();i++){
-                                if(lastlabelList.at(i)->getIndex()!=m_nowIndex){
-                                    lastlabelList.at(i)->setFixedSize(QSize(32,40));
-                                    lastlabelList.at(i)->resize(QSize(32,40));
-                                    lastlabelList.at(i)->setIndexNow(m_nowIndex);
-                                }
-                            }
-                        }
-
-                    }
-
-                }
-            });
-            connect(imageItem, &ImageItem::imageItemclicked, this,
-            [ = ](int index, int indexNow,bool iRet) {
-                m_bMoving=true;
-
-                m_nowIndex = index;
-//                emit imageClicked(index, (index - indexNow));
-                emit imageMoveEnded(index, (index - indexNow),iRet);
-                m_lastIndex=m_nowIndex;
-//                onResize();
-//                m_imgList->adjustSize();
-            });
-
-        }
         if (strCurPath == info.filePath) {
             t = i;
         }
         i++;
     }
 
-    labelList = m_imgList->findChildren<ImageItem *>();
     m_nowIndex = t;
 
     int a = (qCeil(m_imgListView->width() - 26) / 32) / 2;
@@ -1315,34 +1191,15 @@ void TTBContent::reloadItems(DBImgInfoList &inputInfos, QString strCurPath)
     }
 
     qDebug() << "m_startAnimation=" << m_startAnimation;
-//    ImageItem *curitem = m_imgList->findChild<ImageItem *>(strCurPath);
 
-    for (int j = 0; j < labelList.size(); j++) {
-        labelList.at(j)->setFixedSize(QSize(num, 40));
-        labelList.at(j)->resize(QSize(num, 40));
-        labelList.at(j)->setIndexNow(t);
-    }
+    updateVisibleItems();
     //还原7b23fc部分代码
-    if(labelList.size()>0)
-    {
-        for (int k = 0;k<labelList.size();k++) {
-            if(strCurPath == labelList.at(k)->getPath()){
-                labelList.at(k)->setFixedSize(QSize(58, 58));
-                labelList.at(k)->resize(QSize(58, 58));
-                QPixmap imgpix = dApp->m_imagemap.value(strCurPath);
-                if(!imgpix.isNull())
-                    labelList.at(k)->updatePic(imgpix);
-            }
-        }
+    ImageItem *curitem = m_visibleItems.value(m_nowIndex);
+    if (curitem && curitem->getPath() == strCurPath) {
+        QPixmap imgpix = dApp->m_imagemap.value(strCurPath);
+        if(!imgpix.isNull())
+            curitem->updatePic(imgpix);
     }
-//    if (curitem) {
-//        curitem->setFixedSize(QSize(58, 58));
-//        curitem->resize(QSize(58, 58));
-//        //LMH0603，造成死锁的情况了，暂时屏蔽掉该锁，导致点击一张svg图片会卡死
-//        //dApp->getRwLock().lockForRead();
-//        curitem->updatePic(dApp->m_imagemap.value(strCurPath));
-//        //dApp->getRwLock().unlock();
-//    }
 
     m_imgListView->show();
 }
@@ -1544,7 +1401,7 @@ void TTBContent::clickLoad(const int nCurrent)
 
 void TTBContent::OnUpdateThumbnail(QString path)
 {
-    ImageItem* item = m_imgList->findChild<ImageItem*>(path);
+    ImageItem* item = m_pathItems.value(path);
     if(!item) return;
     QPixmap imgpix = dApp->m_imagemap.value(path);
     if(!imgpix.isNull())
@@ -1565,14 +1422,13 @@ void TTBContent::DisEnablettbButton()
 void TTBContent::OnRequestShowVaguePix(QString filepath,bool& thumbnailflag)
 {
     thumbnailflag = false;
-    ImageItem* item =  m_imgList->findChild<ImageItem *>(filepath);
-    if(item){
-        QPixmap pix = item->getPixmap();
-        if(!pix.isNull()){
-            qDebug() << "OnRequestShowVaguePix";
-            emit showvaguepixmap(pix,filepath,false);
-            thumbnailflag = true;
-        }
+    ImageItem* item = m_pathItems.value(filepath);
+    //不在可见范围内的图片没有图元，直接取缓存的缩略图
+    QPixmap pix = item ? item->getPixmap() : dApp->m_imagemap.value(filepath);
+    if(!pix.isNull()){
+        qDebug() << "OnRequestShowVaguePix";
+        emit showvaguepixmap(pix,filepath,false);
+        thumbnailflag = true;
     }
 }
 
@@ -1645,75 +1501,11 @@ void TTBContent::loadBack(DBImgInfoList infos)
     if (infos.size() > 0) {
         onHidePreNextBtn(true, false);
     }
-    //先将先前的图元index改变为最新的
-    int nAddSize = m_imgInfos.size();
-
-    //遍历infos动态生成图元，并将图元加入布局
+    //图元只为可见区域生成，这里只追加图片信息
     foreach (DBImgInfo info, infos) {
-        char *imageType = getImageType(info.filePath);
-        ImageItem *imageItem = new ImageItem(nAddSize, info.filePath, imageType);
-        imageItem->setFixedSize(QSize(32, 40));
-        imageItem->resize(QSize(32, 40));
-        imageItem->installEventFilter(m_imgListView);
-        imageItem->setObjectName(info.filePath);
-        imageItem->setIndexNow(m_nowIndex);
-        /*LMH0727*/
-        //imageItem->setObjectName(QString("%1").arg(m_totalImageItem++));
-        m_imglayout->addWidget(imageItem);
-        connect(imageItem, &ImageItem::imageMoveclicked, this,
-        [ = ](QString path) {
-            m_bMoving=false;
-            if(dApp->m_bMove){
-                m_lastIndex=m_nowIndex;
-                QList <ImageItem *>labelList=m_imgList->findChildren<ImageItem *>(path);
-                if(labelList.size()>0){
-                    ImageItem *img =labelList.at(0);
-                    if(nullptr !=img){
-                        img->setIndexNow(m_nowIndex);
-                        labelList.at(0)->setFixedSize(QSize(58,58));
-                        labelList.at(0)->resize(QSize(58,58));
-                        QPixmap pix=img->getPixmap();
-                        m_nowIndex=img->getIndex();
-                        emit showvaguepixmap(pix,labelList.at(0)->getPath());
-                        emit sigsetcurrent(labelList.at(0)->getPath());
-                    }
-                }
-                if(m_lastIndex >-1){
-                    QList <ImageItem *>lastlabelList=m_imgList->findChildren<ImageItem *>(/*QString("%1").arg(m_lastIndex)*/);
-                    if(lastlabelList.isEmpty()){
-                    }
-                    else {
-                        for(int i=0;i<lastlabelList.size();i++){
-                            if(lastlabelList.at(i)->getIndex()!=m_nowIndex){
-                                lastlabelList.at(i)->setFixedSize(QSize(32,40));
-                                lastlabelList.at(i)->resize(QSize(32,40));
-                                lastlabelList.at(i)->setIndexNow(m_nowIndex);
-                            }
-                        }
-                    }
-
-                }
-
-            }
-        });
-        connect(imageItem, &ImageItem::imageItemclicked, this,
-        [ = ](int index, int indexNow,bool iRet) {
-            m_bMoving=true;
-            m_nowIndex = index;
-//                emit imageClicked(index, (index - indexNow));
-            emit imageMoveEnded(index, (index - indexNow),iRet);
-            m_lastIndex=m_nowIndex;
-//            onResize();
-//            m_imgList->adjustSize();
-        });
-
         m_imgInfos.push_back(info);
-        m_imgList->adjustSize();
-        nAddSize++;
     }
 
-    //将所有图元当前的nowindex重置
-
     onResize();
     if (m_imgInfos.size() > 3) {
         m_imgList->setFixedSize((m_imgInfos.size() + 1) * THUMBNAIL_WIDTH, TOOLBAR_HEIGHT);
@@ -1730,6 +1522,7 @@ void TTBContent::loadBack(DBImgInfoList infos)
         //bug 54009 lmh20201111解决,该操作回弹引起,
         //m_imgList->move(m_nLastMove, m_imgList->y());
     }
+    updateVisibleItems();
 }
 
 void TTBContent::loadFront(DBImgInfoList infos)
@@ -1737,88 +1530,14 @@ void TTBContent::loadFront(DBImgInfoList infos)
     if (infos.size() > 0) {
         onHidePreNextBtn(true, false);
     }
-    //先将先前的图元index改变为最新的
-    int nAddSize = infos.size();
-    m_nowIndex = m_nowIndex + nAddSize;
-    //重置图元当前信息
-    QList<ImageItem *> labelList = m_imgList->findChildren<ImageItem *>();
-    for (int i = 0; i < labelList.size(); i++) {
-        //nCurrentIndex放入循环内初始化
-        int nCurrentIndex = labelList.at(i)->getIndex();
-        labelList.at(i)->setIndex(nCurrentIndex + nAddSize);
-        labelList.at(i)->setIndexNow(m_nowIndex);
-    }
-
-    //将新插入的图元赋值index
-    nAddSize--;
-    //遍历infos动态生成图元，并将图元加入布局
+    //向前插入后所有图元索引后移，回收全部图元后按新索引重新生成
+    m_nowIndex = m_nowIndex + infos.size();
+    clearItems();
     foreach (DBImgInfo info, infos) {
-        char *imageType = getImageType(info.filePath);
-        ImageItem *imageItem = new ImageItem(nAddSize, info.filePath, imageType);
-        imageItem->setFixedSize(QSize(32, 40));
-        imageItem->resize(QSize(32, 40));
-        imageItem->installEventFilter(m_imgListView);
-        imageItem->setObjectName(info.filePath);
-        imageItem->setIndexNow(m_nowIndex);
-        /*LMH0727*/
-        //imageItem->setObjectName(QString("%1").arg(m_totalImageItem++));
-        m_imglayout->insertWidget(0, imageItem);
-        connect(imageItem, &ImageItem::imageMoveclicked, this,
-        [ = ](QString path) {
-            m_bMoving=false;
-            if(dApp->m_bMove){
-                m_lastIndex=m_nowIndex;
-                QList <ImageItem *>labelList=m_imgList->findChildren<ImageItem *>(path);
-                if(labelList.size()>0){
-                    ImageItem *img =labelList.at(0);
-                    if(nullptr !=img){
-                        img->setIndexNow(m_nowIndex);
-                        labelList.at(0)->setFixedSize(QSize(58,58));
-                        labelList.at(0)->resize(QSize(58,58));
-                        QPixmap pix=img->getPixmap();
-                        m_nowIndex=img->getIndex();
-                        emit showvaguepixmap(pix,labelList.at(0)->getPath());
-                        emit sigsetcurrent(labelList.at(0)->getPath());
-                    }
-                }
-                if(m_lastIndex >-1){
-                    QList <ImageItem *>lastlabelList=m_imgList->findChildren<ImageItem *>(/*QString("%1").arg(m_lastIndex)*/);
-                    if(lastlabelList.isEmpty()){
-                    }
-                    else {
-                        for(int i=0;i<lastlabelList.size();i++){
-                            if(lastlabelList.at(i)->getIndex()!=m_nowIndex){
-                                lastlabelList.at(i)->setFixedSize(QSize(32,40));
-                                lastlabelList.at(i)->resize(QSize(32,40));
-                                lastlabelList.at(i)->setIndexNow(m_nowIndex);
-                            }
-                        }
-                    }
-
-                }
-
-            }
-        });
-        connect(imageItem, &ImageItem::imageItemclicked, this,
-        [ = ](int index, int indexNow,bool iRet) {
-            m_bMoving=true;
-            m_nowIndex = index;
-//                emit imageClicked(index, (index - indexNow));
-            emit imageMoveEnded(index, (index - indexNow),iRet);
-            m_lastIndex=m_nowIndex;
-//            onResize();
-//            m_imgList->adjustSize();
-        });
-
         m_imgInfos.push_front(info);
-        m_imgList->adjustSize();
-        nAddSize--;
     }
 
-    labelList = m_imgList->findChildren<ImageItem *>();
-
     onResize();
-    m_imgList->adjustSize();
     if (m_imgInfos.size() > 3) {
         m_imgList->setFixedSize((m_imgInfos.size() + 1) * THUMBNAIL_WIDTH, TOOLBAR_HEIGHT);
         m_imgList->resize((m_imgInfos.size() + 1) * THUMBNAIL_WIDTH + THUMBNAIL_LIST_ADJUST,
@@ -1833,6 +1552,7 @@ void TTBContent::loadFront(DBImgInfoList infos)
         m_imgListView->update();
 //        m_imgList->move(-34 * infos.size() + 100, m_imgList->y());
     }
+    updateVisibleItems();
 }
 
 void TTBContent::ReInitFirstthumbnails(const DBImgInfoList& infos)
@@ -1840,14 +1560,7 @@ void TTBContent::ReInitFirstthumbnails(const DBImgInfoList& infos)
     //clear thumbnails widget
     m_imgInfos.clear();
     m_nowIndex = 0;
-    QLayoutItem *child;
-    while ((child = m_imglayout->takeAt(0)) != nullptr) {
-        //setParent为NULL，防止删除之后界面不消失
-        if (child->widget()) {
-            child->widget()->setParent(nullptr);
-        }
-        delete child;
-    }
+    clearItems();
     loadBack(infos);
 }
 
@@ -1915,18 +1628,7 @@ void TTBContent::resizeEvent(QResizeEvent *event)
     setFixedWidth(m_contentWidth);
     //    setImage(m_imagePath, m_imgInfos);
 
-    QList<ImageItem *> labelList = m_imgList->findChildren<ImageItem *>();
-    for (int j = 0; j < labelList.size(); j++) {
-        labelList.at(j)->setFixedSize(QSize(32, 40));
-        labelList.at(j)->resize(QSize(32, 40));
-        labelList.at(j)->setContentsMargins(1, 5, 1, 5);
-        labelList.at(j)->setIndexNow(m_nowIndex);
-    }
-    if (labelList.size() > 0 &&labelList.size()>m_nowIndex) {
-        labelList.at(m_nowIndex)->setFixedSize(QSize(58, 58));
-        labelList.at(m_nowIndex)->resize(QSize(58, 58));
-        labelList.at(m_nowIndex)->setContentsMargins(0, 0, 0, 0);
-    }
+    updateVisibleItems();
 
     //图动窗口的时候重置缩略图布局
     //emit m_imgListView->mouseLeftReleased();
@@ -1944,7 +1646,6 @@ void TTBContent::setImage(const QString path, DBImgInfoList infos)
         emit dApp->signalM->picNotExists(false);
     }
 
-    QList<ImageItem *> labelList = m_imgList->findChildren<ImageItem *>();
     qDebug() << "时间1";
     //判断当前缩略图个数是否等于传入的缩略图数量，不想等全部删除重新生成新的
     judgeReloadItem(infos, m_imgInfos);
@@ -2025,7 +1726,7 @@ void TTBContent::setImage(const QString path, DBImgInfoList infos)
             } else {
                 m_preButton->setEnabled(true);
             }
-            if (m_nowIndex == labelList.size() - 1) {
+            if (m_nowIndex == m_imgInfos.size() - 1) {
                 m_nextButton->setEnabled(false);
             } else {
                 m_nextButton->setEnabled(true);
@@ -2079,7 +1780,7 @@ void TTBContent::setImage(const QString path, DBImgInfoList infos)
             } else {
                 m_preButton->setEnabled(true);
             }
-            if (m_nowIndex == labelList.size() - 1) {
+            if (m_nowIndex == m_imgInfos.size() - 1) {
                 m_nextButton->setEnabled(false);
             } else {
                 m_nextButton->setEnabled(true);
@@ -2237,3 +1938,133 @@ void TTBContent::onResize()
         m_imgList->move(QPoint(0, 0));
     }
 }
+
+bool TTBContent::eventFilter(QObject *obj, QEvent *e)
+{
+    //m_imgList被拖动、动画移动或者可视区域大小改变时，刷新可见图元
+    if ((obj == m_imgList && (e->type() == QEvent::Move || e->type() == QEvent::Resize))
+            || (obj == m_imgListView && e->type() == QEvent::Resize)) {
+        updateVisibleItems();
+    }
+    return QLbtoDLabel::eventFilter(obj, e);
+}
+
+QRect TTBContent::itemRect(int index) const
+{
+    //与原先水平布局一致：当前项宽58，其后的图元整体右移
+    int y = 1 + (THUMBNAIL_CURRENT_SIZE.height() - THUMBNAIL_ITEM_SIZE.height()) / 2;
+    if (index < m_nowIndex) {
+        return QRect(QPoint(index * THUMBNAIL_WIDTH, y), THUMBNAIL_ITEM_SIZE);
+    } else if (index == m_nowIndex) {
+        return QRect(QPoint(index * THUMBNAIL_WIDTH, 1), THUMBNAIL_CURRENT_SIZE);
+    }
+    return QRect(QPoint(index * THUMBNAIL_WIDTH + THUMBNAIL_CURRENT_SIZE.width() - THUMBNAIL_WIDTH, y),
+                 THUMBNAIL_ITEM_SIZE);
+}
+
+void TTBContent::updateVisibleItems()
+{
+    m_imgListView->setItemCount(m_imgInfos.size());
+    m_imgListView->setCurrentIndex(m_nowIndex);
+    if (m_imgInfos.isEmpty()) {
+        clearItems();
+        return;
+    }
+
+    int left = -m_imgList->x();
+    int right = left + m_imgListView->width();
+    int first = qMax(0, left / THUMBNAIL_WIDTH - THUMBNAIL_VISIBLE_MARGIN);
+    int last = qMin(m_imgInfos.size() - 1, right / THUMBNAIL_WIDTH + THUMBNAIL_VISIBLE_MARGIN);
+
+    QHash<int, ImageItem *>::iterator it = m_visibleItems.begin();
+    while (it != m_visibleItems.end()) {
+        if (it.key() < first || it.key() > last) {
+            releaseItem(it.value());
+            m_pathItems.remove(it.value()->getPath());
+            it = m_visibleItems.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    //选中项改变时，只有新旧选中项之间的图元位置会变化
+    bool relayoutAll = m_layoutIndex < 0;
+    int changedFirst = qMin(m_layoutIndex, m_nowIndex);
+    int changedLast = qMax(m_layoutIndex, m_nowIndex);
+    for (int i = first; i <= last; i++) {
+        ImageItem *item = m_visibleItems.value(i);
+        if (!item) {
+            item = acquireItem();
+            item->reuse(i, m_imgInfos.at(i).filePath);
+            m_visibleItems.insert(i, item);
+            m_pathItems.insert(item->getPath(), item);
+            item->setIndexNow(m_nowIndex);
+            item->setGeometry(itemRect(i));
+            item->show();
+            continue;
+        }
+        //同一索引的图片被替换（如数量不变的列表刷新）时重新绑定
+        const QString &path = m_imgInfos.at(i).filePath;
+        if (item->getPath() != path) {
+            m_pathItems.remove(item->getPath());
+            item->reuse(i, path);
+            m_pathItems.insert(path, item);
+        }
+        item->setIndexNow(m_nowIndex);
+        if (relayoutAll || (i >= changedFirst && i <= changedLast)) {
+            item->setGeometry(itemRect(i));
+        }
+    }
+    m_layoutIndex = m_nowIndex;
+}
+
+void TTBContent::clearItems()
+{
+    foreach (ImageItem *item, m_visibleItems) {
+        releaseItem(item);
+    }
+    m_visibleItems.clear();
+    m_pathItems.clear();
+    m_layoutIndex = -1;
+}
+
+ImageItem *TTBContent::acquireItem()
+{
+    if (!m_freeItems.isEmpty()) {
+        return m_freeItems.takeLast();
+    }
+
+    ImageItem *imageItem = new ImageItem(0, QString(), nullptr, m_imgList);
+    imageItem->installEventFilter(m_imgListView);
+    connect(imageItem, &ImageItem::imageMoveclicked, this,
+    [ = ](QString path) {
+        m_bMoving=false;
+        if(dApp->m_bMove){
+            m_lastIndex=m_nowIndex;
+            ImageItem *img = m_pathItems.value(path);
+            if(nullptr !=img){
+                QPixmap pix=img->getPixmap();
+                m_nowIndex=img->getIndex();
+                emit showvaguepixmap(pix,img->getPath());
+                emit sigsetcurrent(img->getPath());
+            }
+            //当前项改变，重新定位可见图元
+            updateVisibleItems();
+        }
+    });
+    connect(imageItem, &ImageItem::imageItemclicked, this,
+    [ = ](int index, int indexNow,bool iRet) {
+        m_bMoving=true;
+        m_nowIndex = index;
+        emit imageMoveEnded(index, (index - indexNow),iRet);
+        m_lastIndex=m_nowIndex;
+    });
+    return imageItem;
+}
+
+void TTBContent::releaseItem(ImageItem *item)
+{
+    item->hide();
+    item->setObjectName(QString());
+    m_freeItems.append(item);
+}
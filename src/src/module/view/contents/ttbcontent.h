@@ -36,6 +36,7 @@
 #include <dimagebutton.h>
 #include <DThumbnailProvider>
 #include <QPropertyAnimation>
+#include <QHash>
 #include <QHBoxLayout>
 #include <DIconButton>
 #include <DBlurEffectWidget>
@@ -140,6 +141,13 @@ public:
         return _pixmap;
     }
 
+    /**
+     * @brief reuse     回收的图元重新绑定到新的图片上
+     * @param index     新的索引
+     * @param path      新的图片路径
+     */
+    void reuse(int index, const QString &path);
+
     void emitClickSig(QString path);
     void emitClickEndSig();
 signals:
@@ -166,6 +174,13 @@ protected:
     void paintEvent(QPaintEvent *event) override;
 
 private:
+    /**
+     * @brief renderThumbnail   按当前尺寸、选中状态和主题预先绘制圆角缩略图
+     * @param selected          是否为选中项
+     * @param themeType         当前主题
+     */
+    void renderThumbnail(bool selected, DGuiApplicationHelper::ColorType themeType);
+
     int _index;
     int _indexNow = -1;
     DLabel *_image = nullptr;
@@ -175,6 +190,15 @@ private:
     QString m_pixmapstring;
     bool bFirstUpdate = true;
     bool bmouserelease = false;
+    //预先绘制好的缩略图及其对应的状态，状态不变时直接贴图
+    QPixmap m_renderCache;
+    qint64 m_renderPixmapKey = 0;
+    QSize m_renderSize;
+    qreal m_renderRatio = 0;
+    bool m_renderSelected = false;
+    bool m_renderFirstUpdate = true;
+    QRgb m_renderHighlight = 0;
+    DGuiApplicationHelper::ColorType m_renderTheme = DGuiApplicationHelper::UnknownType;
 
 };
 class TTBContent : public QLbtoDLabel
@@ -415,7 +439,37 @@ private slots:
 
 protected:
     void resizeEvent(QResizeEvent *event);
+    bool eventFilter(QObject *obj, QEvent *e) Q_DECL_OVERRIDE;
 private:
+    /**
+     * @brief itemRect  根据索引计算图元在m_imgList中的位置，当前选中项放大显示
+     * @param index     图元索引
+     * @return          图元位置
+     */
+    QRect itemRect(int index) const;
+
+    /**
+     * @brief updateVisibleItems    只为可见区域及两侧少量缓冲生成图元，移出范围的图元回收复用
+     */
+    void updateVisibleItems();
+
+    /**
+     * @brief clearItems    回收所有可见图元，索引整体变化时调用
+     */
+    void clearItems();
+
+    /**
+     * @brief acquireItem   从回收池中取出图元，没有则新建
+     * @return              可用的图元
+     */
+    ImageItem *acquireItem();
+
+    /**
+     * @brief releaseItem   隐藏图元并放回回收池
+     * @param item          需要回收的图元
+     */
+    void releaseItem(ImageItem *item);
+
     bool m_inDB;
 
     DIconButton *m_adaptImageBtn {nullptr};
@@ -428,7 +482,14 @@ private:
     DIconButton *m_nextButton {nullptr};
     ElidedLabel *m_fileNameLabel;
     DWidget *m_imgList;
-    QHBoxLayout *m_imglayout;
+    //当前可见的图元，key为图片索引
+    QHash<int, ImageItem *> m_visibleItems;
+    //回收待复用的图元
+    QList<ImageItem *> m_freeItems;
+    //当前可见的图元，key为图片路径
+    QHash<QString, ImageItem *> m_pathItems;
+    //可见图元位置所对应的选中索引，-1表示需要全部重新定位
+    int m_layoutIndex {-1};
 //    DWidget *m_imgListView;
     MyImageListWidget *m_imgListView;
     DWidget *m_imgListView_prespc;
@@ -481,24 +542,61 @@ public:
      * 更新的缩略图路径
      */
     bool UpdateThumbnail();
+
+    /**
+     * @brief setItemCount  设置缩略图总数，用于判断是否处于首尾位置
+     * @param count         缩略图总数
+     */
+    void setItemCount(int count);
+
+    /**
+     * @brief setCurrentIndex   设置当前选中的缩略图索引，用于按索引计算中线下的图元
+     * @param index             选中项索引
+     */
+    void setCurrentIndex(int index);
 protected:
     bool eventFilter(QObject *obj, QEvent *e) Q_DECL_OVERRIDE;
 signals:
     void mouseLeftReleased();
+
+    /**
+     * @brief itemCentered  拖动或滑动过程中有新的图元移动到中线
+     * @param index         图元索引
+     */
+    void itemCentered(int index);
+
+    /**
+     * @brief centerItemReleased    拖动或滑动结束，确认中线下的图元
+     * @param index                 图元索引
+     */
+    void centerItemReleased(int index);
 private:
+    /**
+     * @brief indexAtMiddle 按图元宽度计算处于中线位置的索引
+     * @return              中线下的索引，没有则返回-1
+     */
+    int indexAtMiddle() const;
+
+    /**
+     * @brief selectMiddleItem  中线下的图元变化时发出itemCentered
+     * @param edgeCount         首尾无法居中的图元个数，当前项处于首尾时不切换
+     */
+    void selectMiddleItem(int edgeCount);
+
     QTimer *m_timer = nullptr;
     bool bmouseleftpressed = false;
     QObject *m_obj = nullptr;
     QPoint m_prepoint;
     QPoint m_lastPoint;
-    ImageItem *m_currentImageItem=nullptr;
+    //最近一次移动到中线的图元索引
+    int m_centeredIndex{-1};
     bool m_iRet=false;
     QVector <QPoint> m_vecPoint;
-    QMutex m_threadMutex;
-    bool m_bthreadMutex=false;
     int m_maxTouchPoints=0;
     qint64 m_lastReleaseTime{0};
     QTimer *m_startTimer{nullptr};
+    int m_itemCount{0};
+    int m_selectedIndex{-1};
 };
 
 
@@ -17,17 +17,174 @@
 #include "graphicsitem.h"
 
 #include <QDebug>
+#include <QHash>
+#include <QImageReader>
+#include <QMutex>
 #include <QPainter>
+#include <QThread>
+#include <QWaitCondition>
+
+namespace {
+
+//全部帧的总大小不超过该值时缓存所有帧（字节）
+const qint64 FRAME_CACHE_LIMIT = 128 * 1024 * 1024;
+//只保留窗口时最多提前解码的帧数
+const int FRAME_WINDOW = 8;
+//帧还没有解码出来时的重试间隔（毫秒）
+const int FRAME_RETRY_INTERVAL = 5;
+//落后超过该时间（如界面卡住）时重新对齐时间轴，不连续追帧
+const int FRAME_LATE_LIMIT = 500;
+
+struct AnimationFrame {
+    QImage image;
+    int delay;
+};
+
+}  // namespace
+
+/*!
+  动图的解码与帧缓存，由解码线程和界面线程共享。
+  缓存全部帧时以帧下标为键，第一轮解码完成后循环使用；
+  只保留窗口时以播放序号为键，每轮重新解码
+*/
+class AnimationDecoder
+{
+public:
+    explicit AnimationDecoder(const QString &fileName)
+        : m_fileName(fileName)
+    {
+    }
+
+    void run()
+    {
+        QImageReader reader(m_fileName);
+        const int loopCount = reader.loopCount();
+        const int imageCount = reader.imageCount();
+        int loop = 0;
+        int index = 0;
+        forever {
+            {
+                QMutexLocker locker(&m_mutex);
+                while (!m_cancel && !m_keepAll && m_decoded - m_released >= FRAME_WINDOW) {
+                    m_wait.wait(&m_mutex);
+                }
+                if (m_cancel)
+                    return;
+            }
+
+            const QImage image = reader.read();
+            if (image.isNull()) {
+                QMutexLocker locker(&m_mutex);
+                if (index == 0) {
+                    //一帧都解码不出来
+                    m_totalSeq = m_decoded;
+                    return;
+                }
+                m_frameCount = index;
+                if (m_keepAll) {
+                    //全部帧已经缓存，之后按下标循环
+                    if (loopCount >= 0)
+                        m_totalSeq = m_frameCount * (loopCount + 1);
+                    return;
+                }
+                loop++;
+                if (loopCount >= 0 && loop > loopCount) {
+                    m_totalSeq = m_decoded;
+                    return;
+                }
+                locker.unlock();
+                reader.setFileName(m_fileName);
+                index = 0;
+                continue;
+            }
+
+            AnimationFrame frame;
+            //转为绘制最快的格式，界面线程直接绘制
+            frame.image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+            frame.delay = reader.nextImageDelay();
+
+            QMutexLocker locker(&m_mutex);
+            if (m_decoded == 0) {
+                m_keepAll = imageCount > 0
+                            && qint64(imageCount) * frame.image.sizeInBytes() <= FRAME_CACHE_LIMIT;
+            }
+            m_frames.insert(m_keepAll ? index : m_decoded, frame);
+            m_decoded++;
+            index++;
+        }
+    }
+
+    void cancel()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_cancel = true;
+        m_wait.wakeAll();
+    }
+
+    /*!
+      取播放序号为seq的帧，还没有解码出来时返回false
+    */
+    bool frameAt(int seq, AnimationFrame &frame) const
+    {
+        QMutexLocker locker(&m_mutex);
+        const int key = (m_keepAll && m_frameCount > 0) ? seq % m_frameCount : seq;
+        auto it = m_frames.constFind(key);
+        if (it == m_frames.constEnd())
+            return false;
+        frame = it.value();
+        return true;
+    }
+
+    /*!
+      seq及之前的帧已经显示，窗口模式下释放并让解码线程继续
+    */
+    void release(int seq)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_keepAll)
+            return;
+        for (int i = m_released; i <= seq; i++) {
+            m_frames.remove(i);
+        }
+        m_released = qMax(m_released, seq + 1);
+        m_wait.wakeAll();
+    }
+
+    /*!
+      循环次数用完或无法解码时，seq之后不会再有帧
+    */
+    bool isFinished(int seq) const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_totalSeq >= 0 && seq >= m_totalSeq;
+    }
+
+private:
+    const QString m_fileName;
+    mutable QMutex m_mutex;
+    QWaitCondition m_wait;
+    QHash<int, AnimationFrame> m_frames;
+    bool m_keepAll = false;
+    bool m_cancel = false;
+    //一轮的帧数，第一轮解码完成后确定
+    int m_frameCount = 0;
+    //已解码的帧数（播放序号）
+    int m_decoded = 0;
+    //界面线程下一个需要的播放序号
+    int m_released = 0;
+    //播放结束时的总帧数，-1为无限循环
+    int m_totalSeq = -1;
+};
 
 GraphicsMovieItem::GraphicsMovieItem(const QString &fileName,const QString &suffix, QGraphicsItem *parent)
     : QGraphicsPixmapItem(fileName, parent)
+    , m_decoder(new AnimationDecoder(fileName))
 {
     Q_UNUSED(suffix);
-    m_movie = new QMovie(fileName);
-    QObject::connect(m_movie, &QMovie::frameChanged, this, [ = ] {
-        if (m_movie.isNull()) return;
-        setPixmap(m_movie->currentPixmap());
-    });
+    m_frameCount = QImageReader(fileName).imageCount();
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&m_timer, &QTimer::timeout, this, &GraphicsMovieItem::showNextFrame);
 }
 
 GraphicsMovieItem::~GraphicsMovieItem()
@@ -38,30 +195,78 @@ GraphicsMovieItem::~GraphicsMovieItem()
     // If not doing this, it may crash
     prepareGeometryChange();
 
-    m_movie->stop();
-    m_movie->deleteLater();
-    m_movie = nullptr;
+    m_timer.stop();
+    m_decoder->cancel();
 }
 
 /*!
  * \brief GraphicsMovieItem::isValid
- * There is a bug with QMovie::isValid() that is event if file's format not
- * supported this function still return true.
+ * 只有一帧的文件不当作动图
  * \return
  */
 bool GraphicsMovieItem::isValid() const
 {
-    return m_movie->frameCount() > 1;
+    return m_frameCount > 1;
 }
 
 void GraphicsMovieItem::start()
 {
-    m_movie->start();
+    if (!m_decoding) {
+        m_decoding = true;
+        QSharedPointer<AnimationDecoder> decoder = m_decoder;
+        QThread *th = QThread::create([decoder]() {
+            decoder->run();
+        });
+        QObject::connect(th, &QThread::finished, th, &QObject::deleteLater);
+        th->start();
+    }
+    m_clock.start();
+    m_nextDue = 0;
+    showNextFrame();
 }
 
 void GraphicsMovieItem::stop()
 {
-    m_movie->stop();
+    m_timer.stop();
+}
+
+void GraphicsMovieItem::showNextFrame()
+{
+    AnimationFrame frame;
+    if (!m_decoder->frameAt(m_seq, frame)) {
+        if (m_decoder->isFinished(m_seq)) {
+            m_timer.stop();
+            return;
+        }
+        //解码还没跟上，时间轴顺延
+        m_nextDue = m_clock.elapsed() + FRAME_RETRY_INTERVAL;
+        m_timer.start(FRAME_RETRY_INTERVAL);
+        return;
+    }
+
+    m_frame = frame.image;
+    update();
+    m_decoder->release(m_seq);
+    m_seq++;
+
+    //与浏览器一致，10毫秒及以下的延时按100毫秒处理
+    m_nextDue += frame.delay > 10 ? frame.delay : 100;
+    const qint64 now = m_clock.elapsed();
+    if (m_nextDue < now - FRAME_LATE_LIMIT) {
+        m_nextDue = now;
+    }
+    m_timer.start(int(qMax<qint64>(0, m_nextDue - now)));
+}
+
+void GraphicsMovieItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    if (m_frame.isNull()) {
+        QGraphicsPixmapItem::paint(painter, option, widget);
+        return;
+    }
+    painter->setRenderHint(QPainter::SmoothPixmapTransform,
+                           (transformationMode() == Qt::SmoothTransformation));
+    painter->drawImage(boundingRect(), m_frame);
 }
 
 
@@ -79,7 +284,43 @@ GraphicsPixmapItem::~GraphicsPixmapItem()
 void GraphicsPixmapItem::setPixmap(const QPixmap &pixmap)
 {
     cachePixmap = qMakePair(cachePixmap.first, pixmap);
+    m_cacheOrientation = 0;
     QGraphicsPixmapItem::setPixmap(pixmap);
+    //尺寸可能改变，重新计算方向变换的平移
+    if (m_orientation != 0) {
+        const int angle = m_orientation;
+        m_orientation = 0;
+        setOrientation(angle);
+    }
+}
+
+void GraphicsPixmapItem::setOrientation(int angle)
+{
+    angle = (angle % 360 + 360) % 360;
+    if (angle % 90 != 0 || angle == m_orientation)
+        return;
+
+    m_orientation = angle;
+    QTransform rotate;
+    rotate.rotate(angle);
+    const QRectF rect = rotate.mapRect(boundingRect());
+    setTransform(rotate * QTransform::fromTranslate(-rect.x(), -rect.y()));
+}
+
+int GraphicsPixmapItem::orientation() const
+{
+    return m_orientation;
+}
+
+QImage GraphicsPixmapItem::orientedImage() const
+{
+    QImage image = pixmap().toImage();
+    if (m_orientation != 0) {
+        QTransform rotate;
+        rotate.rotate(m_orientation);
+        image = image.transformed(rotate);
+    }
+    return image;
 }
 
 void GraphicsPixmapItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
@@ -88,28 +329,34 @@ void GraphicsPixmapItem::paint(QPainter *painter, const QStyleOptionGraphicsItem
     Q_UNUSED(widget);
 
     const QTransform ts = painter->transform();
+    //去掉自身的方向变换后只剩视图缩放
+    const QTransform viewTs = transform().inverted() * ts;
 
-    if (ts.type() == QTransform::TxScale && ts.m11() < 1) {
+    if (viewTs.type() == QTransform::TxScale && viewTs.m11() < 1) {
         painter->setRenderHint(QPainter::SmoothPixmapTransform,
                                (transformationMode() == Qt::SmoothTransformation));
 
         QPixmap pixmap;
 
-        if (qIsNull(cachePixmap.first - ts.m11())) {
+        if (qIsNull(cachePixmap.first - viewTs.m11()) && m_cacheOrientation == m_orientation) {
             pixmap = cachePixmap.second;
         } else {
-            pixmap = this->pixmap().transformed(painter->transform(), transformationMode());
-            cachePixmap = qMakePair(ts.m11(), pixmap);
+            //先缩小再旋转，旋转只作用在屏幕大小的缓存上
+            pixmap = this->pixmap().transformed(viewTs, transformationMode());
+            if (m_orientation != 0) {
+                QTransform rotate;
+                rotate.rotate(m_orientation);
+                pixmap = pixmap.transformed(rotate, Qt::FastTransformation);
+            }
+            cachePixmap = qMakePair(viewTs.m11(), pixmap);
+            m_cacheOrientation = m_orientation;
         }
 
         pixmap.setDevicePixelRatio(painter->device()->devicePixelRatioF());
         painter->resetTransform();
-        painter->drawPixmap(offset() + QPointF(ts.dx(), ts.dy()), pixmap);
+        painter->drawPixmap(ts.mapRect(boundingRect()).topLeft(), pixmap);
         painter->setTransform(ts);
     } else {
         QGraphicsPixmapItem::paint(painter, option, widget);
     }
 }
-
-
-
@@ -18,11 +18,20 @@
 #define GRAPHICSMOVIEITEM_H
 
 #include <QGraphicsPixmapItem>
-#include <QPointer>
-#include <QMovie>
-class QMovie;
-class GraphicsMovieItem : public QGraphicsPixmapItem, QObject
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <QTimer>
+
+class AnimationDecoder;
+
+/*!
+  动图图元：后台线程提前解码帧，帧数少的动图缓存全部帧，帧数多的只保留播放位置之后的一段窗口。
+  界面线程按帧延时的绝对时间轴显示，直接绘制解码好的QImage，不再每帧生成QPixmap。
+  pixmap()始终为第一帧
+*/
+class GraphicsMovieItem : public QObject, public QGraphicsPixmapItem
 {
+    Q_OBJECT
 public:
     explicit GraphicsMovieItem(const QString &fileName,const QString &suffix=NULL,QGraphicsItem *parent = 0);
     ~GraphicsMovieItem();
@@ -30,8 +39,23 @@ public:
     void start();
     void stop();
 
+protected:
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+private slots:
+    void showNextFrame();
+
 private:
-    QPointer<QMovie> m_movie;
+    QSharedPointer<AnimationDecoder> m_decoder;
+    bool m_decoding = false;
+    int m_frameCount = 0;
+    //下一个要显示的帧序号，循环播放时持续递增
+    int m_seq = 0;
+    QImage m_frame;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    //下一帧应当显示的时间（毫秒，相对m_clock）
+    qint64 m_nextDue = 0;
 };
 
 class GraphicsPixmapItem : public QGraphicsPixmapItem
@@ -41,12 +65,25 @@ public:
     ~GraphicsPixmapItem();
 
     void setPixmap(const QPixmap &pixmap);
+    /*!
+      显示方向，90的倍数，顺时针为正。只改变绘制时的变换，不旋转原图像素，
+      旋转后的外接矩形左上角仍在场景原点
+    */
+    void setOrientation(int angle);
+    int orientation() const;
+    /*!
+      按显示方向旋转后的图片，只在需要像素时才旋转
+    */
+    QImage orientedImage() const;
 
 protected:
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
 
 private:
+    //缩小显示时按缩放比例缓存的图，已经转到显示方向
     QPair<qreal, QPixmap> cachePixmap;
+    int m_cacheOrientation = 0;
+    int m_orientation = 0;
 };
 
 #endif // GRAPHICSMOVIEITEM_H
@@ -1,221 +1,187 @@
-//#include "imagesvgitem.h"
-
-//#if !defined(QT_NO_GRAPHICSVIEW) && !defined(QT_NO_WIDGETS)
-
-//#include "dsvgrenderer.h"
-//#include "qdebug.h"
-//#include "qpainter.h"
-//#include "qstyleoption.h"
-
-//#include "private/qgraphicsitem_p.h"
-//#include "private/qobject_p.h"
-//#include <QSvgRenderer>
-//QT_BEGIN_NAMESPACE
-
-//#define Q_DECLARE_PUBLIC(Class)                                    \
-//    inline Class* q_func() { return static_cast<Class *>(q_ptr); } \
-//    inline const Class* q_func() const { return static_cast<const Class *>(q_ptr); } \
-//    friend class Class;
-
-
-//class ImageSvgItemPrivate : public QGraphicsItemPrivate
-//{
-//public:
-//    Q_DECLARE_PUBLIC(ImageSvgItem)
-
-//    ImageSvgItemPrivate()
-//        : renderer(nullptr)
-//        , shared(false)
-//    {
-//    }
-
-//    void init(QGraphicsItem *parent)
-//    {
-//        Q_Q(ImageSvgItem);
-//        q->setParentItem(parent);
-//        renderer = new QSvgRenderer(q);
-//        //        QObject::connect(renderer, SIGNAL(repaintNeeded()),
-//        //                         q, SLOT(_q_repaintItem()));
-//        q->setCacheMode(QGraphicsItem::DeviceCoordinateCache);
-//        q->setMaximumCacheSize(QSize(1024, 768));
-//    }
-
-//    //    void _q_repaintItem()
-//    //    {
-//    //        q_func()->update();
-//    //    }
-
-//    inline void updateDefaultSize()
-//    {
-//        QRectF bounds;
-//        if (elemId.isEmpty()) {
-//            bounds = QRectF(QPointF(0, 0), renderer->defaultSize());
-//        } else {
-//            bounds = renderer->boundsOnElement(elemId);
-//        }
-//        if (boundingRect.size() != bounds.size()) {
-//            q_func()->prepareGeometryChange();
-//            boundingRect.setSize(bounds.size());
-//        }
-//    }
-
-//    QSvgRenderer *renderer;
-//    QRectF boundingRect;
-//    bool shared;
-//    QString elemId;
-//};
-
-//ImageSvgItem::ImageSvgItem(QGraphicsItem *parent)
-////    :QGraphicsSvgItem(parent)
-//    : QGraphicsObject(*new ImageSvgItemPrivate(), 0)
-//{
-//    Q_D(ImageSvgItem);
-//    d->init(parent);
-//}
-
-//ImageSvgItem::ImageSvgItem(const QString &fileName, QGraphicsItem *parent)
-////:QGraphicsSvgItem(parent)
-//    : QGraphicsObject(*new ImageSvgItemPrivate(), 0)
-//{
-//    Q_D(ImageSvgItem);
-//    d->init(parent);
-//    d->renderer->load(fileName);
-//    d->updateDefaultSize();
-//}
-
-//QSvgRenderer *ImageSvgItem::renderer() const
-//{
-//    return d_func()->renderer;
-//}
-
-//QRectF ImageSvgItem::boundingRect() const
-//{
-//    Q_D(const ImageSvgItem);
-//    return d->boundingRect;
-//}
-
-//static void qt_graphicsItem_highlightSelected(QGraphicsItem *item, QPainter *painter,
-//                                              const QStyleOptionGraphicsItem *option)
-//{
-//    const QRectF murect = painter->transform().mapRect(QRectF(0, 0, 1, 1));
-//    if (qFuzzyIsNull(qMax(murect.width(), murect.height())))
-//        return;
-
-//    const QRectF mbrect = painter->transform().mapRect(item->boundingRect());
-//    if (qMin(mbrect.width(), mbrect.height()) < qreal(1.0))
-//        return;
-
-//    qreal itemPenWidth;
-//    switch (item->type()) {
-//        case QGraphicsEllipseItem::Type:
-//            itemPenWidth = static_cast<QGraphicsEllipseItem *>(item)->pen().widthF();
-//            break;
-//        case QGraphicsPathItem::Type:
-//            itemPenWidth = static_cast<QGraphicsPathItem *>(item)->pen().widthF();
-//            break;
-//        case QGraphicsPolygonItem::Type:
-//            itemPenWidth = static_cast<QGraphicsPolygonItem *>(item)->pen().widthF();
-//            break;
-//        case QGraphicsRectItem::Type:
-//            itemPenWidth = static_cast<QGraphicsRectItem *>(item)->pen().widthF();
-//            break;
-//        case QGraphicsSimpleTextItem::Type:
-//            itemPenWidth = static_cast<QGraphicsSimpleTextItem *>(item)->pen().widthF();
-//            break;
-//        case QGraphicsLineItem::Type:
-//            itemPenWidth = static_cast<QGraphicsLineItem *>(item)->pen().widthF();
-//            break;
-//        default:
-//            itemPenWidth = 1.0;
-//    }
-//    const qreal pad = itemPenWidth / 2;
-
-//    const qreal penWidth = 0;  // cosmetic pen
-
-//    const QColor fgcolor = option->palette.windowText().color();
-//    const QColor bgcolor(  // ensure good contrast against fgcolor
-//        fgcolor.red() > 127 ? 0 : 255, fgcolor.green() > 127 ? 0 : 255,
-//        fgcolor.blue() > 127 ? 0 : 255);
-
-//    painter->setPen(QPen(bgcolor, penWidth, Qt::SolidLine));
-//    painter->setBrush(Qt::NoBrush);
-//    painter->drawRect(item->boundingRect().adjusted(pad, pad, -pad, -pad));
-
-//    painter->setPen(QPen(option->palette.windowText(), 0, Qt::DashLine));
-//    painter->setBrush(Qt::NoBrush);
-//    painter->drawRect(item->boundingRect().adjusted(pad, pad, -pad, -pad));
-//}
-
-//void ImageSvgItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
-//{
-//    //    Q_UNUSED(option);
-//    Q_UNUSED(widget);
-
-//    Q_D(ImageSvgItem);
-//    if (!d->renderer->isValid())
-//        return;
-
-//    if (d->elemId.isEmpty())
-//        d->renderer->render(painter, d->boundingRect);
-//    else
-//        d->renderer->render(painter, d->elemId, d->boundingRect);
-
-//    if (option->state & QStyle::State_Selected)
-//        qt_graphicsItem_highlightSelected(this, painter, option);
-//}
-
-//int ImageSvgItem::type() const
-//{
-//    return Type;
-//}
-
-//void ImageSvgItem::setMaximumCacheSize(const QSize &size)
-//{
-//    QGraphicsItem::d_ptr->setExtra(QGraphicsItemPrivate::ExtraMaxDeviceCoordCacheSize, size);
-//    update();
-//}
-
-//QSize ImageSvgItem::maximumCacheSize() const
-//{
-//    return QGraphicsItem::d_ptr->extra(QGraphicsItemPrivate::ExtraMaxDeviceCoordCacheSize).toSize();
-//}
-
-//void ImageSvgItem::setElementId(const QString &id)
-//{
-//    Q_D(ImageSvgItem);
-//    d->elemId = id;
-//    d->updateDefaultSize();
-//    update();
-//}
-
-//QString ImageSvgItem::elementId() const
-//{
-//    Q_D(const ImageSvgItem);
-//    return d->elemId;
-//}
-
-//void ImageSvgItem::setSharedRenderer(QSvgRenderer *renderer)
-//{
-//    Q_D(ImageSvgItem);
-//    if (!d->shared)
-//        delete d->renderer;
-
-//    d->renderer = renderer;
-//    d->shared = true;
-
-//    d->updateDefaultSize();
-
-//    update();
-//}
-
-//void ImageSvgItem::setCachingEnabled(bool caching)
-//{
-//    setCacheMode(caching ? QGraphicsItem::DeviceCoordinateCache : QGraphicsItem::NoCache);
-//}
-
-//bool ImageSvgItem::isCachingEnabled() const
-//{
-//    return cacheMode() != QGraphicsItem::NoCache;
-//}
-
-//#endif  // QT_NO_WIDGETS
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "imagesvgitem.h"
+
+#include <QFile>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QSvgRenderer>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QtMath>
+
+namespace {
+
+//瓦片边长（设备像素）
+const int TILE_SIZE = 256;
+//最高缩放级别，2^6倍
+const int MAX_LEVEL = 6;
+//瓦片缓存上限（KB）
+const int TILE_CACHE_LIMIT = 64 * 1024;
+
+inline quint64 tileKey(int level, int tx, int ty)
+{
+    return (quint64(level) << 56) | (quint64(tx) << 28) | quint64(ty);
+}
+
+inline void tileFromKey(quint64 key, int &level, int &tx, int &ty)
+{
+    level = int(key >> 56);
+    tx = int((key >> 28) & 0xfffffff);
+    ty = int(key & 0xfffffff);
+}
+
+//所有svg图元共用一个渲染线程，渲染本身按互斥锁串行，多开线程没有收益
+QThreadPool *tilePool()
+{
+    static QThreadPool *pool = nullptr;
+    if (!pool) {
+        pool = new QThreadPool;
+        pool->setMaxThreadCount(1);
+    }
+    return pool;
+}
+
+}  // namespace
+
+SvgTileRenderer::SvgTileRenderer(const QByteArray &data, const QSizeF &bounds)
+    : m_renderer(new QSvgRenderer(data, this))
+    , m_bounds(bounds)
+{
+}
+
+bool SvgTileRenderer::isValid() const
+{
+    return m_renderer->isValid();
+}
+
+void SvgTileRenderer::render(int generation, int level, int tx, int ty)
+{
+    if (generation != this->generation.load())
+        return;
+
+    const qreal levelScale = qreal(1 << level);
+    QImage image(TILE_SIZE, TILE_SIZE, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+    painter.translate(-tx * TILE_SIZE, -ty * TILE_SIZE);
+    painter.scale(levelScale, levelScale);
+    {
+        QMutexLocker locker(&m_mutex);
+        m_renderer->render(&painter, QRectF(QPointF(0, 0), m_bounds));
+    }
+    painter.end();
+    emit tileRendered(generation, tileKey(level, tx, ty), image);
+}
+
+ImageSvgItem::ImageSvgItem(const QString &fileName, const QPixmap &pixmap)
+    : GraphicsPixmapItem(pixmap)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+    m_cache.setMaxCost(TILE_CACHE_LIMIT);
+
+    QFile file(fileName);
+    const QByteArray data = file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    //渲染线程可能还持有渲染器，最后由界面线程释放
+    m_tiles = QSharedPointer<SvgTileRenderer>(new SvgTileRenderer(data, boundingRect().size()),
+                                              &QObject::deleteLater);
+    connect(m_tiles.data(), &SvgTileRenderer::tileRendered, this, &ImageSvgItem::onTileRendered,
+            Qt::QueuedConnection);
+}
+
+ImageSvgItem::~ImageSvgItem()
+{
+    m_tiles->generation.ref();
+}
+
+void ImageSvgItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    const QTransform ts = painter->transform();
+    //图元坐标到设备像素的比例，带旋转时同样成立
+    const qreal scale = qSqrt(ts.m11() * ts.m11() + ts.m12() * ts.m12())
+                        * painter->device()->devicePixelRatioF();
+    const qreal previewScale = pixmap().devicePixelRatioF();
+    if (!m_tiles->isValid() || scale <= previewScale) {
+        GraphicsPixmapItem::paint(painter, option, widget);
+        return;
+    }
+
+    const int level = qBound(0, qCeil(std::log2(scale)), MAX_LEVEL);
+    if (level != m_level) {
+        m_level = level;
+        m_pending.clear();
+        m_tiles->generation.ref();
+    }
+
+    const QRectF bounds = boundingRect();
+    const QRectF exposed = option->exposedRect & bounds;
+    const qreal tileSize = TILE_SIZE / qreal(1 << level);
+    const int x0 = qFloor(exposed.left() / tileSize);
+    const int y0 = qFloor(exposed.top() / tileSize);
+    const int x1 = qCeil(exposed.right() / tileSize);
+    const int y1 = qCeil(exposed.bottom() / tileSize);
+
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+    const QPixmap preview = pixmap();
+    for (int ty = y0; ty < y1; ty++) {
+        for (int tx = x0; tx < x1; tx++) {
+            const QRectF target = tileRect(level, tx, ty);
+            if (const QImage *image = m_cache.object(tileKey(level, tx, ty))) {
+                painter->drawImage(target, *image);
+                continue;
+            }
+            requestTile(level, tx, ty);
+            //瓦片还没渲染好，先画默认尺寸的图
+            const QRectF part = target & bounds;
+            painter->drawPixmap(part, preview, QRectF(part.topLeft() * previewScale, part.size() * previewScale));
+        }
+    }
+}
+
+void ImageSvgItem::onTileRendered(int generation, quint64 key, const QImage &image)
+{
+    if (generation != m_tiles->generation.load())
+        return;
+    m_pending.remove(key);
+    m_cache.insert(key, new QImage(image), qMax(1, int(image.sizeInBytes() / 1024)));
+
+    int level = 0;
+    int tx = 0;
+    int ty = 0;
+    tileFromKey(key, level, tx, ty);
+    update(tileRect(level, tx, ty));
+}
+
+QRectF ImageSvgItem::tileRect(int level, int tx, int ty) const
+{
+    const qreal tileSize = TILE_SIZE / qreal(1 << level);
+    return QRectF(tx * tileSize, ty * tileSize, tileSize, tileSize);
+}
+
+void ImageSvgItem::requestTile(int level, int tx, int ty)
+{
+    const quint64 key = tileKey(level, tx, ty);
+    if (m_pending.contains(key))
+        return;
+    m_pending.insert(key);
+    const QSharedPointer<SvgTileRenderer> tiles = m_tiles;
+    const int generation = tiles->generation.load();
+    QtConcurrent::run(tilePool(), [tiles, generation, level, tx, ty] {
+        tiles->render(generation, level, tx, ty);
+    });
+}
@@ -1,61 +1,87 @@
-//#ifndef IMAGESVGITEM_H
-//#define IMAGESVGITEM_H
-
-//#include <QGraphicsObject>
-
-//#include <DSvgRenderer>
-
-//DGUI_USE_NAMESPACE
-
-//#include <QtCore/qglobal.h>
-
-//#if !defined(QT_NO_GRAPHICSVIEW) && !defined(QT_NO_WIDGETS)
-
-//#include <QtWidgets/qgraphicsitem.h>
-
-//#include <QtSvg/qtsvgglobal.h>
-//#include <QGraphicsSvgItem>
-//class QSvgRenderer;
-//class ImageSvgItemPrivate;
-
-//class ImageSvgItem : public QGraphicsObject
-//{
-//    Q_OBJECT
-//    Q_INTERFACES(QGraphicsItem)
-//    Q_PROPERTY(QString elementId READ elementId WRITE setElementId)
-//    Q_PROPERTY(QSize maximumCacheSize READ maximumCacheSize WRITE setMaximumCacheSize)
-
-//public:
-//    ImageSvgItem(QGraphicsItem *parentItem = nullptr);
-//    ImageSvgItem(const QString &fileName, QGraphicsItem *parentItem = nullptr);
-//    void setSharedRenderer(QSvgRenderer *renderer);
-//    QSvgRenderer *renderer() const;
-
-//    void setElementId(const QString &id);
-//    QString elementId() const;
-
-//    void setCachingEnabled(bool);
-//    bool isCachingEnabled() const;
-
-//    void setMaximumCacheSize(const QSize &size);
-//    QSize maximumCacheSize() const;
-
-//    QRectF boundingRect() const override;
-
-//    void paint(QPainter *painter,
-//               const QStyleOptionGraphicsItem *option,
-//               QWidget *widget = nullptr) override;
-
-//    enum { Type = 13 };
-//    int type() const override;
-
-//private:
-//    Q_DISABLE_COPY(ImageSvgItem)
-//    Q_DECLARE_PRIVATE_D(QGraphicsItem::d_ptr.data(), ImageSvgItem)
-
-////    Q_PRIVATE_SLOT(d_func(), void _q_repaintItem())
-//};
-
-//#endif // QT_NO_GRAPHICSVIEW or QT_NO_WIDGETS
-
-//#endif // IMAGESVGITEM_H
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef IMAGESVGITEM_H
+#define IMAGESVGITEM_H
+
+#include "graphicsitem.h"
+
+#include <QAtomicInt>
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QSharedPointer>
+
+class QSvgRenderer;
+
+/*!
+  在后台线程按缩放级别渲染svg瓦片。解析只在构造时做一次，
+  渲染线程之间共用同一个QSvgRenderer，按互斥锁依次渲染
+*/
+class SvgTileRenderer : public QObject
+{
+    Q_OBJECT
+public:
+    SvgTileRenderer(const QByteArray &data, const QSizeF &bounds);
+    bool isValid() const;
+    /*!
+      渲染一块瓦片，代数已经过期时直接返回
+    */
+    void render(int generation, int level, int tx, int ty);
+
+    //缩放级别改变或图元销毁时加一，丢弃还在排队的瓦片
+    QAtomicInt generation;
+
+signals:
+    void tileRendered(int generation, quint64 key, const QImage &image);
+
+private:
+    QMutex m_mutex;
+    QSvgRenderer *m_renderer;
+    QSizeF m_bounds;
+};
+
+/*!
+  svg图元：缩小或原始大小显示时使用默认尺寸栅格化的图，放大后只按当前缩放级别
+  渲染可见区域的瓦片，瓦片未渲染完成时先显示放大的默认图。
+  缩放级别取2的整数次幂，瓦片缓存按内存大小淘汰
+*/
+class ImageSvgItem : public QObject, public GraphicsPixmapItem
+{
+    Q_OBJECT
+public:
+    ImageSvgItem(const QString &fileName, const QPixmap &pixmap);
+    ~ImageSvgItem() override;
+
+protected:
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+private slots:
+    void onTileRendered(int generation, quint64 key, const QImage &image);
+
+private:
+    QRectF tileRect(int level, int tx, int ty) const;
+    void requestTile(int level, int tx, int ty);
+
+    QSharedPointer<SvgTileRenderer> m_tiles;
+    QCache<quint64, QImage> m_cache;
+    QSet<quint64> m_pending;
+    int m_level = -1;
+};
+
+#endif // IMAGESVGITEM_H
@@ -45,10 +45,12 @@
 #include <DSvgRenderer>
 
 #include "application.h"
+#include "controller/rotationwriter.h"
 #include "controller/signalmanager.h"
 #include "graphicsitem.h"
 #include "utils/baseutils.h"
 #include "utils/imageutils.h"
+#include "utils/metadatareader.h"
 #include "utils/snifferimageformat.h"
 #include "widgets/toast.h"
 #include "accessibility/ac-desktop-define.h"
@@ -121,6 +123,8 @@ QVariantList cacheImage(const QString &path)
     QString errMsg;
 #if USE_UNIONIMAGE
     UnionImage_NameSpace::loadStaticImageFromFile(path, tImg, errMsg);
+    //高位深图片按当前曝光转为8位显示
+    tImg = UnionImage_NameSpace::toDisplayImage(tImg);
 #else
     QString format = DetectImageFormat(path);
             QImageReader readerF(path, format.toLatin1());
@@ -134,6 +138,8 @@ QVariantList cacheImage(const QString &path)
             }
 #endif
       QPixmap p = QPixmap::fromImage(tImg);
+    //文件刚被读过，顺便把元数据放入缓存，之后打开信息面板不再读盘
+    utils::image::imageMetaData(path);
 
     QVariantList vl;
     vl << QVariant(path) << QVariant(p);
@@ -255,7 +261,7 @@ QVariantList ImageView::cachePixmap(const QString path)
     else if (!UnionImage_NameSpace::loadStaticImageFromFile(path, tImg, errMsg)) {
         qDebug() << errMsg;
     }
-    QPixmap p = QPixmap::fromImage(tImg);
+    QPixmap p = QPixmap::fromImage(UnionImage_NameSpace::toDisplayImage(tImg));
     if(dApp->m_firstLoad)
     {
         dApp->m_rectmap.insert(path, p.rect());
@@ -330,7 +336,10 @@ ImageView::ImageView(QWidget *parent)
     setMouseTracking(true);
     setTransformationAnchor(AnchorUnderMouse);
     setDragMode(ScrollHandDrag);
-    setViewportUpdateMode(FullViewportUpdate);
+    //只刷新场景中发生变化的区域，避免浮动窗口、加载动画等小范围刷新时重绘整张大图
+    setViewportUpdateMode(SmartViewportUpdate);
+    //背景为纯色填充，与变换无关，缓存后滚动和局部刷新时不再重复填充
+    setCacheMode(CacheBackground);
     setAcceptDrops(false);
     setResizeAnchor(QGraphicsView::AnchorViewCenter);
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
@@ -377,6 +386,7 @@ ImageView::ImageView(QWidget *parent)
         } else {
             m_backgroundColor = utils::common::LIGHT_BACKGROUND_COLOR;
         }
+        resetCachedContent();
         update();
     });
     connect(dApp->signalM, &SignalManager::loadingDisplay, this, [ = ](bool immediately) {
@@ -438,6 +448,8 @@ void ImageView::setImage(const QString path)
 
     //heyi test  识别是否切换了图片，并判定上一张图片旋转状态是否发生了改变
     rotatePixCurrent();
+    //再次打开仍在后台写入的图片时，等写完再读取
+    RotationWriter::instance()->waitForFile(path);
 
     m_path = path;
 
@@ -573,7 +585,7 @@ const QImage ImageView::image(bool brefresh)
        /*lmh0807,解决崩溃的问题*/
     if (m_pixmapItem) {
         // FIXME: access to m_pixmapItem will crash
-        return m_pixmapItem->pixmap().toImage();
+        return m_pixmapItem->orientedImage();
         //    } else if (m_svgItem) {    // svg
     }
     else if (m_movieItem) {  // bit-map
@@ -653,24 +665,13 @@ void ImageView::fitImage()
 
 bool ImageView::rotateClockWise()
 {
-    bool bret = true;
-    if (QFileInfo(m_path).suffix() == "svg") {
-        bret = reloadSvgPix(m_path, 90);
-    } else {
-        bret = rotatePixmap(90);
-    }
-    return bret;
+    //svg同样只改变显示方向，和其它图片一样延后写入
+    return rotatePixmap(90);
 }
 
 bool ImageView::rotateCounterclockwise()
 {
-    bool bret = true;
-    if (QFileInfo(m_path).suffix() == "svg") {
-        bret = reloadSvgPix(m_path, -90);
-    } else {
-        bret = rotatePixmap(-90);
-    }
-    return bret;
+    return rotatePixmap(-90);
 }
 
 void ImageView::centerOn(int x, int y)
@@ -776,15 +777,18 @@ bool ImageView::isFitWindow() const
     return m_isFitWindow;
 }
 
-void ImageView::rotatePixCurrent()
+void ImageView::rotatePixCurrent(bool wait)
 {
     if (0 != m_rotateAngel) {
         m_rotateAngel =  m_rotateAngel % 360;
         if (0 != m_rotateAngel) {
-            utils::image::rotate(m_path, m_rotateAngel);
+            RotationWriter::instance()->enqueue(m_path, m_rotateAngel);
             m_rotateAngel = 0;
         }
     }
+    if (wait && !m_path.isEmpty()) {
+        RotationWriter::instance()->waitForFile(m_path);
+    }
 }
 
 //void ImageView::cacheThread(const QString strPath)
@@ -1035,14 +1039,9 @@ void ImageView::setHighQualityAntialiasing(bool highQualityAntialiasing)
 
 void ImageView::endApp()
 {
+    //只加入写入队列，退出前由RotationWriter::flush统一写完
     if (!m_path.isEmpty()) {
-        if (0 != m_rotateAngel) {
-            m_rotateAngel =  m_rotateAngel % 360;
-            if (0 != m_rotateAngel) {
-                utils::image::rotate(m_path, m_rotateAngel);
-                m_rotateAngel = 0;
-            }
-        }
+        rotatePixCurrent();
     }
 }
 
@@ -1068,22 +1067,11 @@ bool ImageView::reloadSvgPix(QString strPath, int nAngel,bool fitauto)
 bool ImageView::rotatePixmap(int nAngel)
 {
     if(!m_pixmapItem) return false;
-    QPixmap pixmap = m_pixmapItem->pixmap();
-    QMatrix rotate;
-    rotate.rotate(nAngel);
-
-    pixmap = pixmap.transformed(rotate, Qt::FastTransformation);
-    pixmap.setDevicePixelRatio(devicePixelRatioF());
-    scene()->clear();
+    //只改变图元的显示方向，不旋转原图像素，也不重建场景
+    m_pixmapItem->setOrientation(m_pixmapItem->orientation() + nAngel);
     resetTransform();
-    m_pixmapItem = new GraphicsPixmapItem(pixmap);
-    m_pixmapItem->setTransformationMode(Qt::SmoothTransformation);
     // Make sure item show in center of view after reload
-    QRectF rect = m_pixmapItem->boundingRect();
-    //            rect.setHeight(rect.height() + 50);
-    setSceneRect(rect);
-    //            setSceneRect(m_pixmapItem->boundingRect());
-    scene()->addItem(m_pixmapItem);
+    setSceneRect(m_pixmapItem->sceneBoundingRect());
 
     autoFit();
     m_rotateAngel += nAngel;
@@ -1273,13 +1261,12 @@ void ImageView::drawBackground(QPainter *painter, const QRectF &rect)
     //    pmp.fillRect(6, 0, 6, 6, DARK_CHECKER_COLOR);
     //    pmp.end();
 
-    painter->save();
+    //开启CacheBackground后只在缓存失效（主题切换、窗口缩放）时调用，fillRect不修改painter状态，无需save/restore
     painter->fillRect(rect, m_backgroundColor);
 
     //    QPixmap currentImage(m_path);
     //    if (!currentImage.isNull())
     //        painter->fillRect(currentImage.rect(), QBrush(pm));
-    painter->restore();
 }
 
 bool ImageView::event(QEvent *event)
@@ -1374,7 +1361,12 @@ void ImageView::onCacheFinish(QVariantList vl)
             m_morePicFloatWidget->setLabelText(QString::number(m_imageReader->currentImageNumber()+1)+"/"+QString::number(m_imageReader->imageCount()));
 
 
-            m_pixmapItem = new GraphicsPixmapItem(pixmap);
+            //svg放大时按当前缩放在后台重新渲染可见区域，默认尺寸的图作为缩小显示和渲染完成前的替代
+            if (QFileInfo(path).suffix().toLower() == "svg") {
+                m_pixmapItem = new ImageSvgItem(path, pixmap);
+            } else {
+                m_pixmapItem = new GraphicsPixmapItem(pixmap);
+            }
             m_pixmapItem->setTransformationMode(Qt::SmoothTransformation);
             connect(dApp->signalM, &SignalManager::enterScaledMode, this, [ = ](bool scaledmode) {
                 if (!m_pixmapItem) {
@@ -1425,6 +1417,8 @@ void ImageView::onThemeChanged(ViewerThemeManager::AppTheme theme)
         m_backgroundColor = utils::common::LIGHT_BACKGROUND_COLOR;
         m_loadingIconPath = utils::view::LIGHT_LOADINGICON;
     }
+    //背景颜色改变，丢弃缓存的背景
+    resetCachedContent();
     update();
 }
 
@@ -1582,25 +1576,11 @@ void ImageView::OnFinishPinchAnimal()
 //        return;
 //    }
     if(!m_pixmapItem) return;
-    //QStranform旋转到180度有问题，暂未解决，因此动画结束后旋转Pixmap到180
-    QPixmap pixmap;
-    pixmap = m_pixmapItem->pixmap();
-    QMatrix rotate;
-    rotate.rotate(m_endvalue);
-
-    pixmap = pixmap.transformed(rotate, Qt::FastTransformation);
-    pixmap.setDevicePixelRatio(devicePixelRatioF());
-    scene()->clear();
+    //QStranform旋转到180度有问题，暂未解决，因此动画结束后把视图的旋转换成图元的显示方向
     resetTransform();
-    m_pixmapItem = new GraphicsPixmapItem(pixmap);
-    m_pixmapItem->setTransformationMode(Qt::SmoothTransformation);
+    m_pixmapItem->setOrientation(m_pixmapItem->orientation() + qRound(m_endvalue));
     // Make sure item show in center of view after reload
-    QRectF rect = m_pixmapItem->boundingRect();
-    //            rect.setHeight(rect.height() + 50);
-    setSceneRect(rect);
-    //            setSceneRect(m_pixmapItem->boundingRect());
-
-    scene()->addItem(m_pixmapItem);
+    setSceneRect(m_pixmapItem->sceneBoundingRect());
     scale(m_scal,m_scal);
     if(m_bRoate)
     {
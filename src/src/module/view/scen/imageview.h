@@ -119,9 +119,10 @@ public:
     bool isFitWindow() const;
 
     /**
-     * @brief rotatePixCurrent  判断当前图片是否被旋转，如果是，写入本地
+     * @brief rotatePixCurrent  判断当前图片是否被旋转，如果是，交给后台写入本地
+     * @param wait              等待写入完成，之后需要读取、打印或改名本地文件时使用
      */
-    void rotatePixCurrent();
+    void rotatePixCurrent(bool wait = false);
 
 //    /**
 //     * @brief cacheThread   缓存图片线程，将缩略图的图片缓存到
@@ -218,7 +219,7 @@ public slots:
     bool reloadSvgPix(QString strPath, int nAngel,bool fitauto = true);
 
     /**
-     * @brief rotatePixmap  根据角度旋转pixmap
+     * @brief rotatePixmap  根据角度改变图片的显示方向，绘制时才按方向变换，不旋转原图像素
      * @param nAngel        旋转的角度
      */
     bool rotatePixmap(int nAngel);
@@ -148,7 +148,7 @@ void ViewPanel::onMenuItemClicked(QAction *action)
         break;
     case IdStartSlideShow: {
         //20201203旋转本地文件
-        m_viewB->rotatePixCurrent();
+        m_viewB->rotatePixCurrent(true);
         auto vinfo = m_vinfo;
         vinfo.fullScreen = window()->isFullScreen();
         vinfo.lastPanel = this;
@@ -170,7 +170,7 @@ void ViewPanel::onMenuItemClicked(QAction *action)
     }
     case IdPrint: {
         //20201203旋转本地文件
-        m_viewB->rotatePixCurrent();
+        m_viewB->rotatePixCurrent(true);
         killTimer(m_hideCursorTid);
         m_hideCursorTid = 0;
         m_viewB->viewport()->setCursor(Qt::ArrowCursor);
@@ -184,7 +184,7 @@ void ViewPanel::onMenuItemClicked(QAction *action)
 
     case IdRename: {
         //20201203旋转本地文件
-        m_viewB->rotatePixCurrent();
+        m_viewB->rotatePixCurrent(true);
         QString filepath = path;
         QString filename;
         if (PopRenameDialog(filepath, filename)) {
@@ -291,7 +291,7 @@ void ViewPanel::onMenuItemClicked(QAction *action)
             dApp->wpSetter->setWallpaper(m_viewB->image(false));
         }else {
             //20201208旋转本地文件 解决57329（旋转图片后设置壁纸，壁纸仍为旋转前状态）
-            m_viewB->rotatePixCurrent();
+            m_viewB->rotatePixCurrent(true);
             dApp->wpSetter->setWallpaper(path);
         }
         break;
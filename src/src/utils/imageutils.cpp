@@ -18,6 +18,7 @@
 #include "utils/imageutils.h"
 #include "utils/imageutils_libexif.h"
 #include "utils/imageutils_freeimage.h"
+#include "utils/metadatareader.h"
 #include "utils/snifferimageformat.h"
 #include <QBuffer>
 #include <QCryptographicHash>
@@ -56,7 +57,7 @@ const QImage scaleImage(const QString &path, const QSize &size)
         qDebug() << errMsg;
     }
     tImg = tImg.scaled(size);
-    return tImg;
+    return UnionImage_NameSpace::toDisplayImage(tImg);
 #else
     QImageReader reader(path);
     reader.setAutoTransform(true);
@@ -97,20 +98,8 @@ const QImage scaleImage(const QString &path, const QSize &size)
 
 const QDateTime getCreateDateTime(const QString &path)
 {
-    QDateTime dt = libexif::getCreateDateTime(path);
-
-    // fallback to metadata.
-    if (!dt.isValid()) {
-        QString s;
-        s = getAllMetaData(path).value("DateTimeOriginal");
-        if (s.isEmpty()) {
-            s = getAllMetaData(path).value("DateTimeDigitized");
-        }
-        if (s.isEmpty()) {
-            s = QDateTime::currentDateTime().toString();
-        }
-        dt = QDateTime::fromString(s, "yyyy.MM.dd HH:mm:ss");
-    }
+    //拍摄时间从元数据缓存中取，不再单独解析一遍EXIF
+    QDateTime dt = imageMetaData(path).createTime;
 
     // fallback to file create time.
     if (!dt.isValid()) {
@@ -357,11 +346,7 @@ const QFileInfoList getImagesInfo(const QString &dir, bool recursive)
 
 const QString getOrientation(const QString &path)
 {
-#ifdef USE_UNIONIMAGE
-    return UnionImage_NameSpace::getOrientation(path);
-#else
-    return freeimage::getOrientation(path);
-#endif
+    return imageMetaData(path).fields.value("Orientation");
 }
 const QImage loadTga(QString filePath, bool &success)
 {
@@ -532,14 +517,42 @@ const QImage getRotatedImage(const QString &path)
     return tImg;
 }
 
-const QMap<QString, QString> getAllMetaData(const QString &path)
+const QImage loadScaledImage(const QString &path, const QSize &maxSize)
 {
-    /*lmh0724使用USE_UNIONIMAGE*/
+    QImage tImg;
+    QImageReader reader(path);
+    reader.setAutoTransform(true);
+    if (maxSize.isValid() && reader.canRead() && reader.supportsOption(QImageIOHandler::ScaledSize)) {
+        QSize tSize = reader.size();
+        QSize bound = maxSize;
+        //缩放尺寸作用于旋转之前的图像
+        if (reader.transformation() & QImageIOHandler::TransformationRotate90) {
+            bound.transpose();
+        }
+        if (tSize.isValid() && (tSize.width() > bound.width() || tSize.height() > bound.height())) {
+            tSize.scale(bound, Qt::KeepAspectRatio);
+            reader.setScaledSize(tSize);
+        }
+        tImg = reader.read();
+    }
+
+    if (tImg.isNull()) {
+        tImg = getRotatedImage(path);
+        if (maxSize.isValid() && (tImg.width() > maxSize.width() || tImg.height() > maxSize.height())) {
+            tImg = tImg.scaled(maxSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+    }
 #ifdef USE_UNIONIMAGE
-    return UnionImage_NameSpace::getAllMetaData(path);
-#else
-    return freeimage::getAllMetaData(path);
+    //缩放到目标尺寸之后才把高位深图片转为8位
+    tImg = UnionImage_NameSpace::toDisplayImage(tImg);
 #endif
+    return tImg;
+}
+
+const QMap<QString, QString> getAllMetaData(const QString &path)
+{
+    //经过元数据缓存，同一文件不重复读取
+    return readMetaData(path);
 }
 
 const QPixmap cachePixmap(const QString &path)
@@ -576,10 +589,10 @@ QMap<QString, QString> thumbnailAttribute(const QUrl  &url)
         set.insert("Thumb::MTime", QString::number(info.lastModified().toTime_t()));
         set.insert("Software", "Deepin Image Viewer");
 
-        QImageReader reader(path);
-        if (reader.canRead()) {
-            set.insert("Thumb::Image::Width", QString::number(reader.size().width()));
-            set.insert("Thumb::Image::Height", QString::number(reader.size().height()));
+        const QSize size = imageMetaData(path).size;
+        if (size.isValid()) {
+            set.insert("Thumb::Image::Width", QString::number(size.width()));
+            set.insert("Thumb::Image::Height", QString::number(size.height()));
         }
     } else {
         //TODO for other's scheme
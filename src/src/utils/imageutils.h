@@ -45,6 +45,10 @@ const QFileInfoList                 getImagesInfo(const QString &dir,
                                                   bool recursive = true);
 const QString                       getOrientation(const QString &path);
 const QImage                        getRotatedImage(const QString &path);
+/*
+ * 按最大尺寸解码图片，支持缩放解码的格式（如JPEG）直接以目标尺寸解码，其余格式解码后立即缩小
+**/
+const QImage                        loadScaledImage(const QString &path, const QSize &maxSize);
 const QImage loadTga(QString filePath, bool &success);
 /*
  * lmh0901，根据后缀是否是图片
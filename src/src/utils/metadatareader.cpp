@@ -0,0 +1,636 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "utils/metadatareader.h"
+#include "utils/imageutils.h"
+#include "utils/unionimage.h"
+#include <libexif/exif-data.h>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMutexLocker>
+
+namespace {
+
+const char EXIF_HEADER[] = "Exif\0\0";
+const int EXIF_HEADER_SIZE = 6;
+const char PHOTOSHOP_HEADER[] = "Photoshop 3.0";
+const int IPTC_RESOURCE_ID = 0x0404;
+
+struct IptcDataSet {
+    int id;
+    const char *name;
+};
+
+//与FreeImage的IPTC键名保持一致
+const IptcDataSet IPTC_DATASETS[] = {
+    {5, "ObjectName"},
+    {25, "Keywords"},
+    {40, "SpecialInstructions"},
+    {55, "DateCreated"},
+    {80, "By-line"},
+    {85, "By-lineTitle"},
+    {90, "City"},
+    {95, "Province-State"},
+    {101, "Country-PrimaryLocationName"},
+    {105, "Headline"},
+    {110, "Credit"},
+    {115, "Source"},
+    {116, "CopyrightNotice"},
+    {120, "Caption-Abstract"},
+    {122, "Writer-Editor"},
+    {0, nullptr}
+};
+
+inline quint32 readBE16(const uchar *p)
+{
+    return (quint32(p[0]) << 8) | p[1];
+}
+
+inline quint32 readBE32(const uchar *p)
+{
+    return (quint32(p[0]) << 24) | (quint32(p[1]) << 16) | (quint32(p[2]) << 8) | p[3];
+}
+
+inline quint32 readLE16(const uchar *p)
+{
+    return quint32(p[0]) | (quint32(p[1]) << 8);
+}
+
+inline quint32 readLE24(const uchar *p)
+{
+    return quint32(p[0]) | (quint32(p[1]) << 8) | (quint32(p[2]) << 16);
+}
+
+inline quint32 readLE32(const uchar *p)
+{
+    return quint32(p[0]) | (quint32(p[1]) << 8) | (quint32(p[2]) << 16) | (quint32(p[3]) << 24);
+}
+
+//方向的文字与FreeImage_TagToString一致，下标为EXIF方向值
+const char *const ORIENTATION_NAMES[] = {
+    "",
+    "top, left side",
+    "top, right side",
+    "bottom, right side",
+    "bottom, left side",
+    "left side, top",
+    "right side, top",
+    "right side, bottom",
+    "left side, bottom"
+};
+
+void collectExifEntry(ExifEntry *entry, void *user)
+{
+    QMap<QString, QString> *metaData = static_cast<QMap<QString, QString> *>(user);
+    const char *name = exif_tag_get_name_in_ifd(entry->tag, exif_entry_get_ifd(entry));
+    if (!name)
+        return;
+    if (entry->tag == EXIF_TAG_ORIENTATION && entry->format == EXIF_FORMAT_SHORT
+            && entry->components > 0 && entry->parent && entry->parent->parent) {
+        const ExifShort orientation = exif_get_short(entry->data,
+                                                     exif_data_get_byte_order(entry->parent->parent));
+        if (orientation >= 1 && orientation <= 8)
+            metaData->insert(QString::fromLatin1(name), QString::fromLatin1(ORIENTATION_NAMES[orientation]));
+        return;
+    }
+    char buf[1024];
+    exif_entry_get_value(entry, buf, sizeof(buf));
+    const QString value = QString::fromUtf8(buf).trimmed();
+    if (!value.isEmpty())
+        metaData->insert(QString::fromLatin1(name), value);
+}
+
+/**
+ * @brief parseExif 解析以"Exif\0\0"开头或直接以TIFF头开头的EXIF数据
+ */
+void parseExif(const uchar *data, int size, QMap<QString, QString> &metaData)
+{
+    QByteArray exif;
+    if (size >= EXIF_HEADER_SIZE && memcmp(data, EXIF_HEADER, EXIF_HEADER_SIZE) == 0) {
+        exif = QByteArray::fromRawData(reinterpret_cast<const char *>(data), size);
+    } else {
+        exif.reserve(size + EXIF_HEADER_SIZE);
+        exif.append(EXIF_HEADER, EXIF_HEADER_SIZE);
+        exif.append(reinterpret_cast<const char *>(data), size);
+    }
+    ExifData *ed = exif_data_new_from_data(reinterpret_cast<const uchar *>(exif.constData()),
+                                           static_cast<unsigned int>(exif.size()));
+    if (!ed)
+        return;
+    //厂商注释不解析，与原来的FreeImage读取结果一致
+    const ExifIfd ifds[] = {EXIF_IFD_0, EXIF_IFD_EXIF, EXIF_IFD_GPS, EXIF_IFD_INTEROPERABILITY};
+    for (ExifIfd ifd : ifds) {
+        if (ed->ifd[ifd])
+            exif_content_foreach_entry(ed->ifd[ifd], collectExifEntry, &metaData);
+    }
+    exif_data_unref(ed);
+}
+
+/**
+ * @brief parseIptc 解析Photoshop资源块中的IPTC-IIM记录
+ */
+void parseIptc(const uchar *data, int size, QMap<QString, QString> &metaData)
+{
+    int pos = 0;
+    while (pos + 12 <= size) {
+        if (memcmp(data + pos, "8BIM", 4) != 0)
+            return;
+        const int id = int(readBE16(data + pos + 4));
+        //资源名是补齐到偶数长度的Pascal字符串
+        int nameLen = data[pos + 6] + 1;
+        nameLen += nameLen & 1;
+        int p = pos + 6 + nameLen;
+        if (p + 4 > size)
+            return;
+        const int len = int(readBE32(data + p));
+        p += 4;
+        if (len < 0 || p + len > size)
+            return;
+        if (id == IPTC_RESOURCE_ID) {
+            int q = p;
+            while (q + 5 <= p + len && data[q] == 0x1c) {
+                const int record = data[q + 1];
+                const int dataset = data[q + 2];
+                const int dataLen = int(readBE16(data + q + 3));
+                q += 5;
+                //扩展长度的数据集不是文字信息，直接结束
+                if (dataLen & 0x8000 || q + dataLen > p + len)
+                    break;
+                if (record == 2) {
+                    for (const IptcDataSet *d = IPTC_DATASETS; d->name; ++d) {
+                        if (d->id != dataset)
+                            continue;
+                        const QString value = QString::fromUtf8(reinterpret_cast<const char *>(data + q), dataLen).trimmed();
+                        const QString key = QString::fromLatin1(d->name);
+                        if (metaData.contains(key) && !value.isEmpty()) {
+                            metaData[key] += ";" + value;
+                        } else if (!value.isEmpty()) {
+                            metaData.insert(key, value);
+                        }
+                        break;
+                    }
+                }
+                q += dataLen;
+            }
+            return;
+        }
+        pos = p + len + (len & 1);
+    }
+}
+
+bool parseJpeg(const uchar *data, int size, QSize &imageSize, QMap<QString, QString> &metaData)
+{
+    int pos = 2;
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xff)
+            return true;
+        const uchar marker = data[pos + 1];
+        if (marker == 0xff) {
+            pos++;
+            continue;
+        }
+        pos += 2;
+        if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd8))
+            continue;
+        //图像数据开始，之后不会再有元数据
+        if (marker == 0xd9 || marker == 0xda)
+            return true;
+        const int len = int(readBE16(data + pos));
+        if (len < 2 || pos + len > size)
+            return true;
+        const uchar *segment = data + pos + 2;
+        const int segmentSize = len - 2;
+        if (marker == 0xe1 && segmentSize > EXIF_HEADER_SIZE
+                && memcmp(segment, EXIF_HEADER, EXIF_HEADER_SIZE) == 0) {
+            parseExif(segment, segmentSize, metaData);
+        } else if (marker == 0xed && segmentSize > int(sizeof(PHOTOSHOP_HEADER))
+                   && memcmp(segment, PHOTOSHOP_HEADER, sizeof(PHOTOSHOP_HEADER)) == 0) {
+            parseIptc(segment + sizeof(PHOTOSHOP_HEADER), segmentSize - int(sizeof(PHOTOSHOP_HEADER)), metaData);
+        } else if (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc
+                   && segmentSize >= 5) {
+            imageSize = QSize(int(readBE16(segment + 3)), int(readBE16(segment + 1)));
+        }
+        pos += len;
+    }
+    return true;
+}
+
+bool parsePng(const uchar *data, int size, QSize &imageSize, QMap<QString, QString> &metaData)
+{
+    if (size < 24)
+        return false;
+    imageSize = QSize(int(readBE32(data + 16)), int(readBE32(data + 20)));
+    int pos = 8;
+    while (pos + 12 <= size) {
+        const int len = int(readBE32(data + pos));
+        const uchar *type = data + pos + 4;
+        if (len < 0 || memcmp(type, "IDAT", 4) == 0 || memcmp(type, "IEND", 4) == 0)
+            break;
+        if (memcmp(type, "eXIf", 4) == 0 && pos + 8 + len <= size) {
+            parseExif(data + pos + 8, len, metaData);
+        }
+        pos += 12 + len;
+    }
+    return true;
+}
+
+bool parseWebp(const uchar *data, int size, QSize &imageSize, QMap<QString, QString> &metaData)
+{
+    int pos = 12;
+    while (pos + 8 <= size) {
+        const uchar *type = data + pos;
+        const int len = int(readLE32(data + pos + 4));
+        const uchar *chunk = data + pos + 8;
+        if (len < 0)
+            break;
+        if (memcmp(type, "VP8X", 4) == 0 && pos + 18 <= size) {
+            imageSize = QSize(int(readLE24(chunk + 4)) + 1, int(readLE24(chunk + 7)) + 1);
+        } else if (memcmp(type, "VP8 ", 4) == 0 && pos + 18 <= size && !imageSize.isValid()) {
+            imageSize = QSize(int(readLE16(chunk + 6) & 0x3fff), int(readLE16(chunk + 8) & 0x3fff));
+        } else if (memcmp(type, "VP8L", 4) == 0 && pos + 13 <= size && !imageSize.isValid()) {
+            const uchar *b = chunk + 1;
+            imageSize = QSize(1 + int(((b[1] & 0x3f) << 8) | b[0]),
+                              1 + int(((b[3] & 0x0f) << 10) | (b[2] << 2) | ((b[1] & 0xc0) >> 6)));
+        } else if (memcmp(type, "EXIF", 4) == 0 && pos + 8 + len <= size) {
+            parseExif(chunk, len, metaData);
+        }
+        pos += 8 + len + (len & 1);
+    }
+    return true;
+}
+
+QDateTime exifDateTime(const QString &value)
+{
+    QDateTime dt = QDateTime::fromString(value, "yyyy:MM:dd HH:mm:ss");
+    if (!dt.isValid())
+        dt = QDateTime::fromString(value, "yyyy:MM:dd HH:mm");
+    return dt;
+}
+
+const quint32 ORIENTATION_TAG = 0x0112;
+const quint32 TIFF_TYPE_SHORT = 3;
+
+inline quint32 readTiff16(const uchar *p, bool bigEndian)
+{
+    return bigEndian ? readBE16(p) : readLE16(p);
+}
+
+inline quint32 readTiff32(const uchar *p, bool bigEndian)
+{
+    return bigEndian ? readBE32(p) : readLE32(p);
+}
+
+/**
+ * @brief findTiffOrientation 在TIFF结构的IFD0中查找Orientation标签，EXIF块去掉"Exif\0\0"之后同样是TIFF结构
+ * @param base TIFF头在文件中的位置
+ * @param end 标签值不能超出的位置（EXIF所在段的末尾或文件末尾）
+ * @return 标签值在文件中的位置，没有找到返回-1
+ */
+qint64 findTiffOrientation(QFile &file, qint64 base, qint64 end, bool &bigEndian)
+{
+    if (!file.seek(base))
+        return -1;
+    const QByteArray header = file.read(8);
+    if (header.size() < 8)
+        return -1;
+    const uchar *p = reinterpret_cast<const uchar *>(header.constData());
+    if (p[0] == 'I' && p[1] == 'I')
+        bigEndian = false;
+    else if (p[0] == 'M' && p[1] == 'M')
+        bigEndian = true;
+    else
+        return -1;
+    if (readTiff16(p + 2, bigEndian) != 42)
+        return -1;
+
+    const qint64 ifd = base + readTiff32(p + 4, bigEndian);
+    if (!file.seek(ifd))
+        return -1;
+    const QByteArray countData = file.read(2);
+    if (countData.size() < 2)
+        return -1;
+    const int count = int(readTiff16(reinterpret_cast<const uchar *>(countData.constData()), bigEndian));
+    const QByteArray entries = file.read(qint64(count) * 12);
+    for (int i = 0; i + 12 <= entries.size(); i += 12) {
+        const uchar *entry = reinterpret_cast<const uchar *>(entries.constData()) + i;
+        if (readTiff16(entry, bigEndian) != ORIENTATION_TAG)
+            continue;
+        //只处理标准写法：SHORT类型、一个值，值直接保存在条目中
+        if (readTiff16(entry + 2, bigEndian) != TIFF_TYPE_SHORT || readTiff32(entry + 4, bigEndian) != 1)
+            return -1;
+        const qint64 offset = ifd + 2 + i + 8;
+        return offset + 2 <= end ? offset : -1;
+    }
+    return -1;
+}
+
+/**
+ * @brief findOrientation 按段查找JPEG的EXIF块，或直接查找TIFF的IFD0，只读取需要的几十个字节
+ * @return Orientation标签值在文件中的位置，没有找到返回-1
+ */
+qint64 findOrientation(QFile &file, bool &bigEndian)
+{
+    const QByteArray magic = file.read(4);
+    if (magic.size() < 4)
+        return -1;
+    const uchar *m = reinterpret_cast<const uchar *>(magic.constData());
+    if (memcmp(m, "II*\0", 4) == 0 || memcmp(m, "MM\0*", 4) == 0)
+        return findTiffOrientation(file, 0, file.size(), bigEndian);
+    if (m[0] != 0xff || m[1] != 0xd8)
+        return -1;
+
+    qint64 pos = 2;
+    forever {
+        if (!file.seek(pos))
+            return -1;
+        const QByteArray segment = file.read(4 + EXIF_HEADER_SIZE);
+        if (segment.size() < 4)
+            return -1;
+        const uchar *p = reinterpret_cast<const uchar *>(segment.constData());
+        if (p[0] != 0xff)
+            return -1;
+        const uchar marker = p[1];
+        if (marker == 0xff) {
+            pos++;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd8)) {
+            pos += 2;
+            continue;
+        }
+        //图像数据开始，之后不会再有EXIF
+        if (marker == 0xd9 || marker == 0xda)
+            return -1;
+        const qint64 len = readBE16(p + 2);
+        if (len < 2)
+            return -1;
+        if (marker == 0xe1 && len > 2 + EXIF_HEADER_SIZE && segment.size() == 4 + EXIF_HEADER_SIZE
+                && memcmp(p + 4, EXIF_HEADER, EXIF_HEADER_SIZE) == 0) {
+            return findTiffOrientation(file, pos + 4 + EXIF_HEADER_SIZE, pos + 2 + len, bigEndian);
+        }
+        pos += 2 + len;
+    }
+}
+
+}  // namespace
+
+namespace utils {
+
+namespace image {
+
+bool parseHeader(const QByteArray &header, QString &format, QSize &size,
+                 QMap<QString, QString> &metaData)
+{
+    const uchar *data = reinterpret_cast<const uchar *>(header.constData());
+    const int len = header.size();
+    if (len < 12)
+        return false;
+
+    if (data[0] == 0xff && data[1] == 0xd8) {
+        format = "jpeg";
+        return parseJpeg(data, len, size, metaData);
+    }
+    if (memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0) {
+        format = "png";
+        return parsePng(data, len, size, metaData);
+    }
+    if (memcmp(data, "GIF8", 4) == 0) {
+        format = "gif";
+        size = QSize(int(readLE16(data + 6)), int(readLE16(data + 8)));
+        return true;
+    }
+    if (data[0] == 'B' && data[1] == 'M' && len >= 26) {
+        format = "bmp";
+        size = QSize(qAbs(qint32(readLE32(data + 18))), qAbs(qint32(readLE32(data + 22))));
+        return true;
+    }
+    if (memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WEBP", 4) == 0) {
+        format = "webp";
+        return parseWebp(data, len, size, metaData);
+    }
+    return false;
+}
+
+MetaDataCache *MetaDataCache::instance()
+{
+    static MetaDataCache cache;
+    return &cache;
+}
+
+bool MetaDataCache::find(const QFileInfo &info, ImageMetaData &data)
+{
+    const QString path = info.absoluteFilePath();
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.constFind(path);
+    if (it == m_entries.constEnd())
+        return false;
+    if (it->mtime != info.lastModified() || it->size != info.size()) {
+        m_entries.remove(path);
+        m_order.removeOne(path);
+        return false;
+    }
+    data = it->data;
+    m_order.removeOne(path);
+    m_order.append(path);
+    return true;
+}
+
+void MetaDataCache::insert(const QFileInfo &info, const ImageMetaData &data)
+{
+    const QString path = info.absoluteFilePath();
+    QMutexLocker locker(&m_mutex);
+    Entry entry;
+    entry.mtime = info.lastModified();
+    entry.size = info.size();
+    entry.data = data;
+    if (m_entries.contains(path))
+        m_order.removeOne(path);
+    m_entries.insert(path, entry);
+    m_order.append(path);
+    while (m_order.size() > METADATA_CACHE_LIMIT) {
+        m_entries.remove(m_order.takeFirst());
+    }
+}
+
+void MetaDataCache::remove(const QString &path)
+{
+    const QString absolutePath = QFileInfo(path).absoluteFilePath();
+    QMutexLocker locker(&m_mutex);
+    m_entries.remove(absolutePath);
+    m_order.removeOne(absolutePath);
+}
+
+void MetaDataCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_order.clear();
+}
+
+int MetaDataCache::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.size();
+}
+
+bool readHeaderMetaData(const QString &path, ImageMetaData &data)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    const QByteArray header = file.read(METADATA_HEADER_LIMIT);
+    file.close();
+
+    QString format;
+    QSize size;
+    QMap<QString, QString> admMap;
+    if (!parseHeader(header, format, size, admMap))
+        return false;
+
+    QFileInfo info(path);
+    //文件头中没有EXIF日期时使用文件时间
+    QDateTime ot = exifDateTime(admMap.value("DateTimeOriginal"));
+    data.createTime = ot;
+    QDateTime dt = exifDateTime(admMap.value("DateTimeDigitized"));
+    QDateTime t = exifDateTime(admMap.value("DateTime"));
+    if (t.isValid())
+        admMap.insert("DateTime", t.toString("yyyy/MM/dd HH:mm"));
+    if (!ot.isValid())
+        ot = t;
+    if (!dt.isValid())
+        dt = ot;
+    if (admMap.isEmpty()) {
+        admMap.insert("DateTimeDigitized", info.lastModified().toString("yyyy/MM/dd HH:mm"));
+    } else if (!ot.isValid()) {
+        admMap.insert("DateTimeOriginal", info.birthTime().toString("yyyy/MM/dd HH:mm"));
+        admMap.insert("DateTimeDigitized", info.lastModified().toString("yyyy/MM/dd HH:mm"));
+    } else {
+        admMap.insert("DateTimeOriginal", ot.toString("yyyy/MM/dd HH:mm"));
+        admMap.insert("DateTimeDigitized", dt.toString("yyyy/MM/dd HH:mm"));
+    }
+
+    //尺寸不在读取的范围内时才让QImageReader再读一次文件头
+    if (!size.isValid())
+        size = QImageReader(path).size();
+    admMap.insert("Dimension", QString::number(size.width()) + "x" + QString::number(size.height()));
+    admMap.insert("FileName", info.fileName());
+    admMap.insert("FileFormat", format);
+#ifdef USE_UNIONIMAGE
+    admMap.insert("FileSize", UnionImage_NameSpace::size2Human(info.size()));
+#else
+    admMap.insert("FileSize", QString::number(info.size()));
+#endif
+    data.fields = admMap;
+    data.size = size;
+    return true;
+}
+
+const ImageMetaData imageMetaData(const QString &path)
+{
+    const QFileInfo info(path);
+    ImageMetaData data;
+    if (MetaDataCache::instance()->find(info, data))
+        return data;
+
+    if (!readHeaderMetaData(path, data)) {
+        data = ImageMetaData();
+        /*lmh0724使用USE_UNIONIMAGE*/
+#ifdef USE_UNIONIMAGE
+        data.fields = UnionImage_NameSpace::getAllMetaData(path);
+#endif
+        data.createTime = QDateTime::fromString(data.fields.value("DateTimeOriginal"), "yyyy/MM/dd HH:mm");
+        const QStringList rl = data.fields.value("Dimension").split("x");
+        if (rl.length() == 2) {
+            data.size = QSize(rl.first().toInt(), rl.last().toInt());
+        }
+    }
+    if (info.exists())
+        MetaDataCache::instance()->insert(info, data);
+    return data;
+}
+
+const QMap<QString, QString> readMetaData(const QString &path)
+{
+    return imageMetaData(path).fields;
+}
+
+int rotatedOrientation(int orientation, int angle)
+{
+    //顺时针旋转90度后的方向值，下标为原方向值
+    static const int ROTATE_CW[] = {0, 6, 7, 8, 5, 2, 3, 4, 1};
+    if (orientation < 1 || orientation > 8)
+        return orientation;
+    int turns = ((angle / 90) % 4 + 4) % 4;
+    while (turns-- > 0)
+        orientation = ROTATE_CW[orientation];
+    return orientation;
+}
+
+int readOrientationTag(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+    bool bigEndian = false;
+    const qint64 offset = findOrientation(file, bigEndian);
+    if (offset < 0 || !file.seek(offset))
+        return 0;
+    const QByteArray value = file.read(2);
+    if (value.size() < 2)
+        return 0;
+    const int orientation = int(readTiff16(reinterpret_cast<const uchar *>(value.constData()), bigEndian));
+    return orientation >= 1 && orientation <= 8 ? orientation : 0;
+}
+
+bool rotateOrientationTag(const QString &path, int angle)
+{
+    if (angle % 90 != 0)
+        return false;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite))
+        return false;
+    bool bigEndian = false;
+    const qint64 offset = findOrientation(file, bigEndian);
+    if (offset < 0 || !file.seek(offset))
+        return false;
+    const QByteArray value = file.read(2);
+    if (value.size() < 2)
+        return false;
+    const int orientation = int(readTiff16(reinterpret_cast<const uchar *>(value.constData()), bigEndian));
+    if (orientation < 1 || orientation > 8)
+        return false;
+
+    const int rotated = rotatedOrientation(orientation, angle);
+    if (rotated != orientation) {
+        //不走临时文件替换：1-8的高字节总是0，只需改写低字节，单字节写入不会被读取方
+        //看到一半，也不用复制整个文件；原地写入同时保留了文件的属主、链接和扩展属性
+        const char patch = char(rotated);
+        if (!file.seek(offset + (bigEndian ? 1 : 0)) || file.write(&patch, 1) != 1 || !file.flush())
+            return false;
+        file.close();
+        if (file.error() != QFileDevice::NoError)
+            return false;
+        //同一毫秒内多次旋转时修改时间可能不变，直接丢弃缓存的方向
+        MetaDataCache::instance()->remove(path);
+    }
+    return true;
+}
+
+}  // namespace image
+
+}  // namespace utils
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef METADATAREADER_H
+#define METADATAREADER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+
+class QFileInfo;
+
+namespace utils {
+
+namespace image {
+
+//文件头最多读取的字节数
+const qint64 METADATA_HEADER_LIMIT = 512 * 1024;
+//元数据缓存最多保存的文件数
+const int METADATA_CACHE_LIMIT = 1024;
+
+/*
+ * 一张图片的元数据：fields与getAllMetaData的键值相同，
+ * createTime为EXIF拍摄时间（精确到秒），没有时为无效时间
+**/
+struct ImageMetaData {
+    QMap<QString, QString> fields;
+    QDateTime createTime;
+    QSize size;
+};
+
+/**
+ * @brief The MetaDataCache class
+ * 按(路径, 修改时间, 文件大小)缓存的元数据，信息面板、方向、拍摄时间和缩略图属性查询共用，
+ * 文件被修改（如旋转后保存）时修改时间或大小改变，缓存自动失效
+ */
+class MetaDataCache
+{
+public:
+    static MetaDataCache *instance();
+
+    bool find(const QFileInfo &info, ImageMetaData &data);
+    void insert(const QFileInfo &info, const ImageMetaData &data);
+    void remove(const QString &path);
+    void clear();
+    int count() const;
+
+private:
+    MetaDataCache() {}
+
+    struct Entry {
+        QDateTime mtime;
+        qint64 size;
+        ImageMetaData data;
+    };
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    //最近使用的在末尾，超过上限时从头部淘汰
+    QList<QString> m_order;
+};
+
+/**
+ * @brief readHeaderMetaData 只读取一次文件头部解析尺寸、EXIF和IPTC，
+ * 不解码像素也不使用FreeImage的全局锁，可以在任意线程调用
+ * @param path 图片路径
+ * @param data 解析结果
+ * @return 文件头无法识别（如RAW、SVG等）时返回false
+ */
+bool readHeaderMetaData(const QString &path, ImageMetaData &data);
+
+/**
+ * @brief parseHeader 解析内存中的文件头
+ * @param header 文件开头的数据
+ * @param format 识别出的格式名，与QImageReader::format()一致
+ * @param size 图片尺寸，文件头中没有时为无效尺寸
+ * @param metaData EXIF和IPTC信息
+ * @return 格式无法识别时返回false
+ */
+bool parseHeader(const QByteArray &header, QString &format, QSize &size,
+                 QMap<QString, QString> &metaData);
+
+/**
+ * @brief imageMetaData 先查元数据缓存，未命中时优先按文件头解析，
+ * 文件头无法识别的格式退回getAllMetaData，结果写入缓存
+ */
+const ImageMetaData imageMetaData(const QString &path);
+
+/**
+ * @brief readMetaData 与getAllMetaData键值相同的元数据，经过元数据缓存
+ */
+const QMap<QString, QString> readMetaData(const QString &path);
+
+/**
+ * @brief rotatedOrientation EXIF方向值（1-8）再顺时针旋转angle度后的方向值，镜像方向同样适用
+ */
+int rotatedOrientation(int orientation, int angle);
+
+/**
+ * @brief readOrientationTag 读取JPEG的EXIF或TIFF的IFD0中的Orientation标签
+ * @return 1-8，没有标签时返回0
+ */
+int readOrientationTag(const QString &path);
+
+/**
+ * @brief rotateOrientationTag 只改写Orientation标签把图片顺时针旋转angle度，不重新编码像素。
+ * 标签值原地改写一个字节，其余数据不变
+ * @return 格式不是JPEG/TIFF或文件中没有Orientation标签时返回false，文件不做任何修改
+ */
+bool rotateOrientationTag(const QString &path, int angle);
+
+}  // namespace image
+
+}  // namespace utils
+
+#endif // METADATAREADER_H
@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "pixelconvert.h"
+
+#include <FreeImage.h>
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PIXELCONVERT_SSE2
+#endif
+
+//8位每通道的BGR(A)布局恰好与小端QImage::Format_(A)RGB32相同，可以整块复制和移位拼接
+#if FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+#define PIXELCONVERT_BGR_NATIVE
+#endif
+
+namespace utils {
+
+namespace image {
+
+namespace {
+
+const float LUMINANCE_R = 0.2126f;
+const float LUMINANCE_G = 0.7152f;
+const float LUMINANCE_B = 0.0722f;
+
+inline float luminance(float r, float g, float b)
+{
+    return LUMINANCE_R * r + LUMINANCE_G * g + LUMINANCE_B * b;
+}
+
+inline float toneMapChannel(float v, float factor)
+{
+    return std::sqrt(qBound(0.0f, v * factor, 1.0f));
+}
+
+inline int quantize(float v, float scale)
+{
+    return static_cast<int>(v * scale + 0.5f);
+}
+
+/*
+ * 单个像素色调映射，输出[0, 1]的gamma编码值
+ */
+void toneMapPixel(const float *p, int channels, float exposure, ToneMapOperator op, float out[4])
+{
+    const float r = qMax(0.0f, p[0]);
+    const float g = channels >= 3 ? qMax(0.0f, p[1]) : r;
+    const float b = channels >= 3 ? qMax(0.0f, p[2]) : r;
+    float factor = exposure;
+    if (op == ToneMapReinhard) {
+        const float l = luminance(r, g, b);
+        const float ls = l * exposure;
+        factor = l > 0.0f ? ls / (1.0f + ls) / l : 0.0f;
+    }
+    out[0] = toneMapChannel(r, factor);
+    out[1] = toneMapChannel(g, factor);
+    out[2] = toneMapChannel(b, factor);
+    out[3] = channels == 4 ? qBound(0.0f, p[3], 1.0f) : 1.0f;
+}
+
+#if defined(PIXELCONVERT_SSE2)
+/*
+ * 4个像素色调映射，r、g、b、a为[0, 1]的gamma编码值。RGBA直接转置为通道向量，RGB和灰度按通道收集
+ */
+inline void toneMap4(const float *p, int channels, __m128 exposure, ToneMapOperator op,
+                     __m128 &r, __m128 &g, __m128 &b, __m128 &a)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    if (channels == 4) {
+        r = _mm_loadu_ps(p);
+        g = _mm_loadu_ps(p + 4);
+        b = _mm_loadu_ps(p + 8);
+        a = _mm_loadu_ps(p + 12);
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+        a = _mm_min_ps(_mm_max_ps(a, zero), one);
+    } else if (channels == 3) {
+        r = _mm_set_ps(p[9], p[6], p[3], p[0]);
+        g = _mm_set_ps(p[10], p[7], p[4], p[1]);
+        b = _mm_set_ps(p[11], p[8], p[5], p[2]);
+        a = one;
+    } else {
+        r = g = b = _mm_loadu_ps(p);
+        a = one;
+    }
+    r = _mm_max_ps(r, zero);
+    g = _mm_max_ps(g, zero);
+    b = _mm_max_ps(b, zero);
+    __m128 factor = exposure;
+    if (op == ToneMapReinhard) {
+        const __m128 l = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(LUMINANCE_R)),
+                                               _mm_mul_ps(g, _mm_set1_ps(LUMINANCE_G))),
+                                    _mm_mul_ps(b, _mm_set1_ps(LUMINANCE_B)));
+        const __m128 ls = _mm_mul_ps(l, exposure);
+        //亮度为0时ls也为0，factor为0
+        factor = _mm_div_ps(_mm_div_ps(ls, _mm_add_ps(one, ls)), _mm_max_ps(l, _mm_set1_ps(1e-20f)));
+    }
+    r = _mm_sqrt_ps(_mm_min_ps(_mm_mul_ps(r, factor), one));
+    g = _mm_sqrt_ps(_mm_min_ps(_mm_mul_ps(g, factor), one));
+    b = _mm_sqrt_ps(_mm_min_ps(_mm_mul_ps(b, factor), one));
+}
+
+inline __m128i quantize(__m128 v, __m128 scale)
+{
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), _mm_set1_ps(0.5f)));
+}
+#endif
+
+}  // namespace
+
+void convertBgr24ToRgb32(const uchar *src, QRgb *dst, int width)
+{
+    int x = 0;
+#if defined(PIXELCONVERT_SSE2) && defined(PIXELCONVERT_BGR_NATIVE)
+    //每次4个像素：按3字节错位取出各像素所在的双字，再拼成连续的4个双字并补满alpha。
+    //一次读入16字节，保证不越过行尾
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000));
+    for (; x + 6 <= width; x += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 3));
+        const __m128i p01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+        const __m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x),
+                         _mm_or_si128(_mm_unpacklo_epi64(p01, p23), alpha));
+    }
+#endif
+    for (; x < width; ++x) {
+        const uchar *p = src + x * 3;
+        dst[x] = qRgb(p[FI_RGBA_RED], p[FI_RGBA_GREEN], p[FI_RGBA_BLUE]);
+    }
+}
+
+void convertBgra32ToArgb32(const uchar *src, QRgb *dst, int width)
+{
+#if defined(PIXELCONVERT_BGR_NATIVE)
+    memcpy(dst, src, static_cast<size_t>(width) * 4);
+#else
+    for (int x = 0; x < width; ++x) {
+        const uchar *p = src + x * 4;
+        dst[x] = qRgba(p[FI_RGBA_RED], p[FI_RGBA_GREEN], p[FI_RGBA_BLUE], p[FI_RGBA_ALPHA]);
+    }
+#endif
+}
+
+void convertRgb48ToRgba64(const quint16 *src, quint16 *dst, int width)
+{
+    int x = 0;
+#if defined(PIXELCONVERT_SSE2) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    //每次2个像素：第二个像素错开6字节，两个四字拼接后第4个字补满alpha
+    const __m128i alpha = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    for (; x + 3 <= width; x += 2) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 3));
+        const __m128i p01 = _mm_unpacklo_epi64(v, _mm_srli_si128(v, 6));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), _mm_or_si128(p01, alpha));
+    }
+#endif
+    for (; x < width; ++x) {
+        dst[x * 4] = src[x * 3];
+        dst[x * 4 + 1] = src[x * 3 + 1];
+        dst[x * 4 + 2] = src[x * 3 + 2];
+        dst[x * 4 + 3] = 0xffff;
+    }
+}
+
+void convertRgba64ToRgba64(const quint16 *src, quint16 *dst, int width)
+{
+    memcpy(dst, src, static_cast<size_t>(width) * 8);
+}
+
+void convertGray16ToRgba64(const quint16 *src, quint16 *dst, int width)
+{
+    int x = 0;
+#if defined(PIXELCONVERT_SSE2) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    //每次8个像素：灰度与自身交错得到(g,g)，与全1交错得到(g,0xffff)，再按双字交错得到(g,g,g,0xffff)
+    const __m128i ones = _mm_set1_epi16(-1);
+    for (; x + 8 <= width; x += 8) {
+        const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        const __m128i gg0 = _mm_unpacklo_epi16(g, g);
+        const __m128i ga0 = _mm_unpacklo_epi16(g, ones);
+        const __m128i gg1 = _mm_unpackhi_epi16(g, g);
+        const __m128i ga1 = _mm_unpackhi_epi16(g, ones);
+        __m128i *out = reinterpret_cast<__m128i *>(dst + x * 4);
+        _mm_storeu_si128(out, _mm_unpacklo_epi32(gg0, ga0));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi32(gg0, ga0));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi32(gg1, ga1));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi32(gg1, ga1));
+    }
+#endif
+    for (; x < width; ++x) {
+        dst[x * 4] = src[x];
+        dst[x * 4 + 1] = src[x];
+        dst[x * 4 + 2] = src[x];
+        dst[x * 4 + 3] = 0xffff;
+    }
+}
+
+double sumLogLuminance(const float *src, int channels, int width)
+{
+    double sum = 0.0;
+    for (int x = 0; x < width; ++x) {
+        const float *p = src + x * channels;
+        const float l = channels >= 3 ? luminance(qMax(0.0f, p[0]), qMax(0.0f, p[1]), qMax(0.0f, p[2]))
+                                      : qMax(0.0f, p[0]);
+        sum += std::log(1e-4 + l);
+    }
+    return sum;
+}
+
+void toneMapFloatToArgb32(const float *src, int channels, QRgb *dst, int width, float exposure,
+                          ToneMapOperator op)
+{
+    int x = 0;
+#if defined(PIXELCONVERT_SSE2)
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 vexposure = _mm_set1_ps(exposure);
+    for (; x + 4 <= width; x += 4) {
+        __m128 r, g, b, a;
+        toneMap4(src + x * channels, channels, vexposure, op, r, g, b, a);
+        const __m128i argb = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(quantize(a, scale), 24),
+                                                       _mm_slli_epi32(quantize(r, scale), 16)),
+                                          _mm_or_si128(_mm_slli_epi32(quantize(g, scale), 8),
+                                                       quantize(b, scale)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), argb);
+    }
+#endif
+    for (; x < width; ++x) {
+        float out[4];
+        toneMapPixel(src + x * channels, channels, exposure, op, out);
+        dst[x] = qRgba(quantize(out[0], 255.0f), quantize(out[1], 255.0f),
+                       quantize(out[2], 255.0f), quantize(out[3], 255.0f));
+    }
+}
+
+void toneMapFloatToRgba64(const float *src, int channels, quint16 *dst, int width, float exposure,
+                          ToneMapOperator op)
+{
+    int x = 0;
+#if defined(PIXELCONVERT_SSE2) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    //SSE2没有无符号饱和打包，先减去0x8000按有符号打包再翻转最高位；
+    //打包后为(r0..r3,g0..g3)和(b0..b3,a0..a3)，两次交错得到RGBA顺序
+    const __m128 scale = _mm_set1_ps(65535.0f);
+    const __m128 vexposure = _mm_set1_ps(exposure);
+    const __m128i bias = _mm_set1_epi32(0x8000);
+    const __m128i sign = _mm_set1_epi16(static_cast<short>(0x8000));
+    for (; x + 4 <= width; x += 4) {
+        __m128 r, g, b, a;
+        toneMap4(src + x * channels, channels, vexposure, op, r, g, b, a);
+        const __m128i rg = _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(quantize(r, scale), bias),
+                                                         _mm_sub_epi32(quantize(g, scale), bias)), sign);
+        const __m128i ba = _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(quantize(b, scale), bias),
+                                                         _mm_sub_epi32(quantize(a, scale), bias)), sign);
+        const __m128i rgPairs = _mm_unpacklo_epi16(rg, _mm_srli_si128(rg, 8));
+        const __m128i baPairs = _mm_unpacklo_epi16(ba, _mm_srli_si128(ba, 8));
+        __m128i *out = reinterpret_cast<__m128i *>(dst + x * 4);
+        _mm_storeu_si128(out, _mm_unpacklo_epi32(rgPairs, baPairs));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi32(rgPairs, baPairs));
+    }
+#endif
+    for (; x < width; ++x) {
+        float out[4];
+        toneMapPixel(src + x * channels, channels, exposure, op, out);
+        for (int c = 0; c < 4; ++c) {
+            dst[x * 4 + c] = static_cast<quint16>(quantize(out[c], 65535.0f));
+        }
+    }
+}
+
+void buildExposureTable(uchar *table, float gain)
+{
+    //编码值近似gamma 2.0，平方回到线性光乘以增益后再开方
+    for (int i = 0; i < EXPOSURE_TABLE_SIZE; ++i) {
+        const float v = i / 65535.0f;
+        table[i] = static_cast<uchar>(quantize(std::sqrt(qMin(v * v * gain, 1.0f)), 255.0f));
+    }
+}
+
+void convertRgba64ToArgb32(const quint16 *src, QRgb *dst, int width, const uchar *table)
+{
+    for (int x = 0; x < width; ++x) {
+        const quint16 *p = src + x * 4;
+        dst[x] = qRgba(table[p[0]], table[p[1]], table[p[2]], p[3] >> 8);
+    }
+}
+
+}  // namespace image
+
+}  // namespace utils
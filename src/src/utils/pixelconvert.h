@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2016 ~ 2018 Deepin Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PIXELCONVERT_H
+#define PIXELCONVERT_H
+
+#include <QtGlobal>
+#include <QRgb>
+
+namespace utils {
+
+namespace image {
+
+//Reinhard色调映射的场景基准亮度
+const float TONEMAP_KEY = 0.18f;
+//16位编码值到8位显示值的曝光查找表大小
+const int EXPOSURE_TABLE_SIZE = 65536;
+
+/*
+ * 浮点图的色调映射方式：Reinhard压缩高光，Clip按曝光线性缩放后截断
+**/
+enum ToneMapOperator {
+    ToneMapReinhard = 0,
+    ToneMapClip = 1
+};
+
+/*
+ * FreeImage扫描线到QImage扫描线的逐行转换内核，x86上使用SSE2，其余平台为标量实现。
+ * 输入为FreeImage的像素布局：8位每通道时按FI_RGBA_*顺序，16位和浮点为RGB(A)顺序；width为像素数
+**/
+
+/**
+ * @brief convertBgr24ToRgb32 24位彩色转为QImage::Format_RGB32
+ */
+void convertBgr24ToRgb32(const uchar *src, QRgb *dst, int width);
+
+/**
+ * @brief convertBgra32ToArgb32 32位彩色转为QImage::Format_ARGB32
+ */
+void convertBgra32ToArgb32(const uchar *src, QRgb *dst, int width);
+
+/**
+ * @brief convertRgb48ToRgba64 FIT_RGB16转为QImage::Format_RGBA64，alpha补满
+ */
+void convertRgb48ToRgba64(const quint16 *src, quint16 *dst, int width);
+
+/**
+ * @brief convertRgba64ToRgba64 FIT_RGBA16转为QImage::Format_RGBA64，两者内存布局相同
+ */
+void convertRgba64ToRgba64(const quint16 *src, quint16 *dst, int width);
+
+/**
+ * @brief convertGray16ToRgba64 FIT_UINT16灰度转为QImage::Format_RGBA64
+ */
+void convertGray16ToRgba64(const quint16 *src, quint16 *dst, int width);
+
+/**
+ * @brief sumLogLuminance 一行浮点像素亮度的对数和，用于求整幅图的对数平均亮度
+ * @param channels 1（FIT_FLOAT）、3（FIT_RGBF）或4（FIT_RGBAF）
+ */
+double sumLogLuminance(const float *src, int channels, int width);
+
+/**
+ * @brief toneMapFloatToArgb32 色调映射后以近似gamma 2.0编码为QImage::Format_ARGB32
+ * @param exposure 曝光系数，一般为TONEMAP_KEY除以对数平均亮度
+ */
+void toneMapFloatToArgb32(const float *src, int channels, QRgb *dst, int width, float exposure,
+                          ToneMapOperator op = ToneMapReinhard);
+
+/**
+ * @brief toneMapFloatToRgba64 同toneMapFloatToArgb32，输出16位的QImage::Format_RGBA64，
+ * 缩放到屏幕尺寸之后再转为8位
+ */
+void toneMapFloatToRgba64(const float *src, int channels, quint16 *dst, int width, float exposure,
+                          ToneMapOperator op = ToneMapReinhard);
+
+/**
+ * @brief buildExposureTable 生成16位编码值到8位显示值的查找表，gain为线性光下的曝光增益
+ * @param table EXPOSURE_TABLE_SIZE个元素
+ */
+void buildExposureTable(uchar *table, float gain);
+
+/**
+ * @brief convertRgba64ToArgb32 按曝光查找表把QImage::Format_RGBA64转为QImage::Format_ARGB32
+ */
+void convertRgba64ToArgb32(const quint16 *src, QRgb *dst, int width, const uchar *table);
+
+}  // namespace image
+
+}  // namespace utils
+
+#endif // PIXELCONVERT_H
@@ -19,11 +19,14 @@
 * along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 #include "unionimage.h"
+#include "metadatareader.h"
 #include <FreeImage.h>
 
 #include <QObject>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QAtomicInt>
+#include <QThreadStorage>
 #include <QDate>
 #include <QTime>
 #include <QtMath>
@@ -32,11 +35,21 @@
 #include <QPainter>
 #include <QSvgGenerator>
 #include <QImageReader>
+#include <QBuffer>
+#include <QFile>
 #include <QtSvg/QSvgRenderer>
 #include <QMimeDatabase>
 
+#include <cstdio>
+#include <limits>
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#endif
+
 
 #define SAVE_QUAITY_VALUE 100
+//显示曝光的调节范围（档）
+const qreal EXPOSURE_STOPS_LIMIT = 4.0;
 
 const QString DATETIME_FORMAT_NORMAL = "yyyy.MM.dd";
 const QString DATETIME_FORMAT_EXIF = "yyyy:MM:dd HH:mm";
@@ -100,6 +113,36 @@ enum FIF_QTSUPPORT{
     FIF_MRW = 37
 };
 
+/*
+ * 每个线程独立的FreeImage上下文。FreeImage的插件注册表在库加载后只读，
+ * 各插件的Load/Save只使用本次调用的句柄，可以在多个线程并行调用；
+ * 全局共享的只有错误输出回调，这里按线程分别记录，互不覆盖
+ */
+struct FreeImageThreadContext {
+    QString lastError;
+};
+
+static QThreadStorage<FreeImageThreadContext> freeimage_context;
+
+static void freeImageOutputMessage(FREE_IMAGE_FORMAT fif, const char *msg)
+{
+    const char *format = fif != FIF_UNKNOWN ? FreeImage_GetFormatFromFIF(fif) : nullptr;
+    freeimage_context.localData().lastError = format ? QString("%1: %2").arg(format).arg(msg)
+                                                     : QString(msg);
+}
+
+/*
+ * 取出并清空当前线程最近一次FreeImage错误
+ */
+static QString takeFreeImageError()
+{
+    QString error;
+    if (freeimage_context.hasLocalData()) {
+        qSwap(error, freeimage_context.localData().lastError);
+    }
+    return error;
+}
+
 class UnionImage_Private
 {
 
@@ -109,6 +152,7 @@ public:
     UnionImage_Private()
     {
         //FreeImage_Initialise(true);
+        FreeImage_SetOutputMessage(freeImageOutputMessage);
         //m_freeimage_formats["UNKNOWN"] = -1;
         m_freeimage_formats["BMP"]     =  FIF_BMP;
         m_freeimage_formats["ICO"]     =  FIF_ICO;
@@ -189,7 +233,13 @@ public:
     {
 
     }
-    QMutex freeimage_mutex;
+    //FreeImage_TagToString返回库内静态缓冲，转换并拷贝标签字符串时需要互斥，其余调用不加锁
+    QMutex tagstring_mutex;
+    //浮点图的色调映射方式和显示时的曝光（千分之一档）
+    QAtomicInt m_toneMapOperator {utils::image::ToneMapReinhard};
+    QAtomicInt m_exposureMilliStops {0};
+    //JPEG/TIFF旋转时只改写EXIF方向标签
+    QAtomicInt m_rotateByOrientationTag {1};
     QStringList m_qtSupported;
     QHash<QString, int> m_freeimage_formats;
     QHash<QString, int> m_movie_formats;
@@ -199,6 +249,141 @@ public:
 
 static UnionImage_Private union_image_private;
 
+//无法映射时只读取文件头时读入的字节数，够文件头嗅探使用
+const qint64 MAPPED_HEADER_SIZE = 1024;
+
+/*
+ * 只读映射整个图片文件。格式检测、FreeImage和QImageReader直接读映射内存，
+ * 不经过stdio和QFile的用户态缓冲拷贝。
+ * 无法映射的文件（如管道）完整解码时一次性读入；超过2GB装不进QByteArray的文件和
+ * 只读文件头的访问只读入开头一段，此时isComplete()为false，解码按路径进行
+ */
+class MappedImageFile
+{
+public:
+    enum Access {
+        HeaderOnly,     //只读取文件头和元数据，不预读整个文件
+        WholeFile       //完整解码，提示内核顺序预读
+    };
+
+    explicit MappedImageFile(const QString &path, Access access = WholeFile)
+        : m_file(path)
+    {
+        if (!m_file.open(QIODevice::ReadOnly)) {
+            return;
+        }
+        const qint64 size = m_file.size();
+        const bool fitsInMemory = size <= std::numeric_limits<int>::max();
+        if (size > 0 && fitsInMemory) {
+            m_map = m_file.map(0, size);
+        }
+        if (m_map) {
+#ifdef Q_OS_LINUX
+            madvise(m_map, static_cast<size_t>(size), MADV_SEQUENTIAL);
+            if (access == WholeFile) {
+                madvise(m_map, static_cast<size_t>(size), MADV_WILLNEED);
+            }
+#endif
+            m_data = QByteArray::fromRawData(reinterpret_cast<const char *>(m_map), static_cast<int>(size));
+            m_complete = true;
+        } else if (access == WholeFile && fitsInMemory) {
+            m_data = m_file.readAll();
+            m_complete = true;
+        } else {
+            m_data = m_file.read(MAPPED_HEADER_SIZE);
+        }
+    }
+
+    ~MappedImageFile()
+    {
+        if (m_stream) {
+            FreeImage_CloseMemory(m_stream);
+        }
+        if (m_map) {
+            m_file.unmap(m_map);
+        }
+    }
+
+    bool isOpen() const
+    {
+        return m_file.isOpen();
+    }
+
+    QString errorString() const
+    {
+        return m_file.errorString();
+    }
+
+    /*
+     * 文件内容，映射时不复制数据，只能在本对象存活期间使用；
+     * isComplete()为false时只有文件开头
+     */
+    const QByteArray &data() const
+    {
+        return m_data;
+    }
+
+    /*
+     * data()是否为完整的文件内容，不完整时格式检测和解码需要按路径读取
+     */
+    bool isComplete() const
+    {
+        return m_complete;
+    }
+
+    QString path() const
+    {
+        return m_file.fileName();
+    }
+
+    /*
+     * FreeImage格式检测，内容不完整时按路径检测（部分格式需要读取文件尾）
+     */
+    FREE_IMAGE_FORMAT fileType()
+    {
+        if (m_complete) {
+            return FreeImage_GetFileTypeFromMemory(stream());
+        }
+        return FreeImage_GetFileType(path().toUtf8().data());
+    }
+
+    /*
+     * FreeImage解码，内容不完整时按路径解码
+     */
+    FIBITMAP *load(FREE_IMAGE_FORMAT fif, int flags = 0)
+    {
+        if (m_complete) {
+            return FreeImage_LoadFromMemory(fif, stream(), flags);
+        }
+        return FreeImage_Load(fif, path().toUtf8().data(), flags);
+    }
+
+    /*
+     * 映射内存上的FreeImage只读流，每次取用时回到开头
+     */
+    FIMEMORY *stream()
+    {
+        if (!m_stream) {
+            m_stream = FreeImage_OpenMemory(reinterpret_cast<BYTE *>(const_cast<char *>(m_data.constData())),
+                                            static_cast<DWORD>(m_data.size()));
+        } else {
+            FreeImage_SeekMemory(m_stream, 0, SEEK_SET);
+        }
+        return m_stream;
+    }
+
+private:
+    Q_DISABLE_COPY(MappedImageFile)
+
+    QFile m_file;
+    uchar *m_map = nullptr;
+    QByteArray m_data;
+    bool m_complete = false;
+    FIMEMORY *m_stream = nullptr;
+};
+
+static FREE_IMAGE_FORMAT detectImageFormat_f(const QString &path, MappedImageFile &file);
+
 /**
  * @brief noneQImage
  * @return QImage
@@ -338,6 +523,7 @@ UNIONIMAGESHARED_EXPORT QMap<QString, QString> getMetaData(FREE_IMAGE_MDMODEL mo
     FIMETADATA *mdhandle = nullptr;
     mdhandle = FreeImage_FindFirstMetadata(model, dib, &tag);
     if (mdhandle) {
+        QMutexLocker locker(&union_image_private.tagstring_mutex);
         do {
             mdMap.insert(FreeImage_GetTagKey(tag),
                          FreeImage_TagToString(model, tag));
@@ -353,6 +539,91 @@ UNIONIMAGESHARED_EXPORT QMap<QString, QString> getMetaData(FREE_IMAGE_MDMODEL mo
  * @return QImage
  * 由FreeImage转到QImage
  */
+/*
+ * 逐行转换像素，FreeImage的第0行在图片底部，输出时上下翻转
+ */
+template <typename Src, typename Dst, typename Kernel>
+static void convertScanLines(FIBITMAP *dib, QImage &result, Kernel kernel)
+{
+    const int width = result.width();
+    const int height = result.height();
+    for (int y = 0; y < height; ++y) {
+        kernel(reinterpret_cast<const Src *>(FreeImage_GetScanLine(dib, static_cast<unsigned>(height - 1 - y))),
+               reinterpret_cast<Dst *>(result.scanLine(y)), width);
+    }
+}
+
+/*
+ * 16位每通道的灰度和彩色图转为QImage::Format_RGBX64/RGBA64，保留全部精度；
+ * 不带alpha的图用RGBX64，toDisplayImage后为RGB32，绘制时不需要混合
+ */
+static QImage highBitDepth2QImage(FIBITMAP *dib)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    const FREE_IMAGE_TYPE type = FreeImage_GetImageType(dib);
+    QImage result(static_cast<int>(FreeImage_GetWidth(dib)), static_cast<int>(FreeImage_GetHeight(dib)),
+                  type == FIT_RGBA16 ? QImage::Format_RGBA64 : QImage::Format_RGBX64);
+    if (result.isNull())
+        return noneQImage();
+    switch (type) {
+    case FIT_UINT16:
+        convertScanLines<quint16, quint16>(dib, result, utils::image::convertGray16ToRgba64);
+        break;
+    case FIT_RGB16:
+        convertScanLines<quint16, quint16>(dib, result, utils::image::convertRgb48ToRgba64);
+        break;
+    default:
+        convertScanLines<quint16, quint16>(dib, result, utils::image::convertRgba64ToRgba64);
+        break;
+    }
+    return result;
+#else
+    //Qt 5.12之前没有64位格式，由FreeImage降为8位
+    FIBITMAP *standard = FreeImage_ConvertToStandardType(dib, TRUE);
+    QImage result = FIBitmap2QImage(standard);
+    FreeImage_Unload(standard);
+    return result;
+#endif
+}
+
+/*
+ * 浮点图（HDR、EXR）按整幅图的对数平均亮度自动曝光并做色调映射，
+ * Qt 5.12起保留16位精度，缩放到显示尺寸后再由toDisplayImage转为8位
+ */
+static QImage floatImage2QImage(FIBITMAP *dib, int channels)
+{
+    const int width = static_cast<int>(FreeImage_GetWidth(dib));
+    const int height = static_cast<int>(FreeImage_GetHeight(dib));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    QImage result(width, height, channels == 4 ? QImage::Format_RGBA64 : QImage::Format_RGBX64);
+#else
+    QImage result(width, height, channels == 4 ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+#endif
+    if (result.isNull())
+        return noneQImage();
+    //每4行采样一行估计曝光
+    double sum = 0.0;
+    qint64 count = 0;
+    for (int y = 0; y < height; y += 4) {
+        sum += utils::image::sumLogLuminance(reinterpret_cast<const float *>(FreeImage_GetScanLine(dib, static_cast<unsigned>(y))),
+                                             channels, width);
+        count += width;
+    }
+    const double logAverage = count > 0 ? std::exp(sum / count) : 1.0;
+    const float exposure = static_cast<float>(utils::image::TONEMAP_KEY / qMax(logAverage, 1e-6));
+    const utils::image::ToneMapOperator op = static_cast<utils::image::ToneMapOperator>(
+                                                 union_image_private.m_toneMapOperator.load());
+    for (int y = 0; y < height; ++y) {
+        const float *line = reinterpret_cast<const float *>(FreeImage_GetScanLine(dib, static_cast<unsigned>(height - 1 - y)));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        utils::image::toneMapFloatToRgba64(line, channels, reinterpret_cast<quint16 *>(result.scanLine(y)), width, exposure, op);
+#else
+        utils::image::toneMapFloatToArgb32(line, channels, reinterpret_cast<QRgb *>(result.scanLine(y)), width, exposure, op);
+#endif
+    }
+    return result;
+}
+
 UNIONIMAGESHARED_EXPORT QImage FIBitmap2QImage(FIBITMAP *dib)
 {
     if (!dib || FreeImage_GetImageType(dib) == FIT_UNKNOWN)
@@ -360,6 +631,27 @@ UNIONIMAGESHARED_EXPORT QImage FIBitmap2QImage(FIBITMAP *dib)
     int width  = static_cast<int>(FreeImage_GetWidth(dib));
     int height = static_cast<int>(FreeImage_GetHeight(dib));
     int depth = static_cast<int>(FreeImage_GetBPP(dib));
+    switch (FreeImage_GetImageType(dib)) {
+    case FIT_BITMAP:
+        break;
+    case FIT_UINT16:
+    case FIT_RGB16:
+    case FIT_RGBA16:
+        return highBitDepth2QImage(dib);
+    case FIT_FLOAT:
+        return floatImage2QImage(dib, 1);
+    case FIT_RGBF:
+        return floatImage2QImage(dib, 3);
+    case FIT_RGBAF:
+        return floatImage2QImage(dib, 4);
+    default: {
+        //其余类型（有符号、32位整型、双精度、复数）由FreeImage线性缩放为8位
+        FIBITMAP *standard = FreeImage_ConvertToStandardType(dib, TRUE);
+        QImage result = FIBitmap2QImage(standard);
+        FreeImage_Unload(standard);
+        return result;
+    }
+    }
     switch (depth) {
     case 1: {
         QImage result(width, height, QImage::Format_Mono);
@@ -380,6 +672,16 @@ UNIONIMAGESHARED_EXPORT QImage FIBitmap2QImage(FIBITMAP *dib)
         FreeImage_ConvertToRawBits(
             result.scanLine(0), dib, result.bytesPerLine(), 8, 0, 0, 0, true
         );
+        //带上调色板，否则灰度和索引色图片无法正确绘制
+        const RGBQUAD *palette = FreeImage_GetPalette(dib);
+        if (palette) {
+            QVector<QRgb> colorTable;
+            const unsigned colors = FreeImage_GetColorsUsed(dib);
+            for (unsigned i = 0; i < colors; ++i) {
+                colorTable << qRgb(palette[i].rgbRed, palette[i].rgbGreen, palette[i].rgbBlue);
+            }
+            result.setColorTable(colorTable);
+        }
         return result;
     }
     case 16:
@@ -405,33 +707,89 @@ UNIONIMAGESHARED_EXPORT QImage FIBitmap2QImage(FIBITMAP *dib)
         }
     case 24: {
         QImage result(width, height, QImage::Format_RGB32);
-        FreeImage_ConvertToRawBits(
-            result.scanLine(0), dib, result.bytesPerLine(), 32,
-            FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK,
-            true
-        );
+        if (result.isNull())
+            return noneQImage();
+        convertScanLines<uchar, QRgb>(dib, result, utils::image::convertBgr24ToRgb32);
         return result;
     }
     case 32: {
         QImage result(width, height, QImage::Format_ARGB32);
-        FreeImage_ConvertToRawBits(
-            result.scanLine(0), dib, result.bytesPerLine(), 32,
-            FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK,
-            true
-        );
+        if (result.isNull())
+            return noneQImage();
+        convertScanLines<uchar, QRgb>(dib, result, utils::image::convertBgra32ToArgb32);
         return result;
     }
-    case 48:
-    case 64:
-    case 96:
-    //128位暂不支持
-    case 128:
     default:
         break;
     }
     return noneQImage();
 }
 
+static void unloadFIBitmap(void *dib)
+{
+    FreeImage_Unload(static_cast<FIBITMAP *>(dib));
+}
+
+UNIONIMAGESHARED_EXPORT QImage wrapFIBitmap2QImage(FIBITMAP *dib)
+{
+    if (!dib)
+        return noneQImage();
+    const FREE_IMAGE_TYPE type = FreeImage_GetImageType(dib);
+    QImage::Format format = QImage::Format_Invalid;
+#if FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if (type == FIT_BITMAP && FreeImage_GetBPP(dib) == 32)
+        format = QImage::Format_ARGB32;
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if (type == FIT_RGBA16)
+        format = QImage::Format_RGBA64;
+#endif
+    //FreeImage自下而上存储，原地翻转后行序与QImage一致，像素内存直接交给QImage
+    if (format != QImage::Format_Invalid && FreeImage_HasPixels(dib) && FreeImage_FlipVertical(dib)) {
+        return QImage(FreeImage_GetBits(dib), static_cast<int>(FreeImage_GetWidth(dib)),
+                      static_cast<int>(FreeImage_GetHeight(dib)), static_cast<int>(FreeImage_GetPitch(dib)),
+                      format, unloadFIBitmap, dib);
+    }
+    QImage result = FIBitmap2QImage(dib);
+    FreeImage_Unload(dib);
+    return result;
+}
+
+UNIONIMAGESHARED_EXPORT void setHdrDisplay(int toneMapOperator, qreal exposureStops)
+{
+    union_image_private.m_toneMapOperator.store(toneMapOperator == utils::image::ToneMapClip
+                                                ? utils::image::ToneMapClip : utils::image::ToneMapReinhard);
+    union_image_private.m_exposureMilliStops.store(qRound(qBound(-EXPOSURE_STOPS_LIMIT, exposureStops, EXPOSURE_STOPS_LIMIT) * 1000));
+}
+
+UNIONIMAGESHARED_EXPORT void setRotateByOrientationTag(bool enable)
+{
+    union_image_private.m_rotateByOrientationTag.store(enable ? 1 : 0);
+}
+
+UNIONIMAGESHARED_EXPORT QImage toDisplayImage(const QImage &image)
+{
+    if (image.isNull() || image.depth() <= 32)
+        return image;
+    const QImage::Format format = image.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32;
+    const int milliStops = union_image_private.m_exposureMilliStops.load();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    if (milliStops != 0 && (image.format() == QImage::Format_RGBA64 || image.format() == QImage::Format_RGBX64)) {
+        QImage result(image.size(), format);
+        if (result.isNull())
+            return noneQImage();
+        QVector<uchar> table(utils::image::EXPOSURE_TABLE_SIZE);
+        utils::image::buildExposureTable(table.data(), static_cast<float>(qPow(2.0, milliStops / 1000.0)));
+        for (int y = 0; y < image.height(); ++y) {
+            utils::image::convertRgba64ToArgb32(reinterpret_cast<const quint16 *>(image.constScanLine(y)),
+                                                reinterpret_cast<QRgb *>(result.scanLine(y)), image.width(), table.constData());
+        }
+        return result;
+    }
+#endif
+    return image.convertToFormat(format);
+}
+
 /**
  * @brief QImgeToFIBitMap
  * @param img
@@ -540,12 +898,10 @@ UNIONIMAGESHARED_EXPORT QImage FIBitmap2QImage(FIBITMAP *dib)
  */
 UNIONIMAGESHARED_EXPORT FIBITMAP *readFile2FIBITMAP(const QString &path, int flags FI_DEFAULT(0))
 {
-    QByteArray b;
-    b.append(path);
-    const char *pc = b.data();
-    const FREE_IMAGE_FORMAT fif = detectImageFormat_f(path);
+    MappedImageFile file(path, (flags & FIF_LOAD_NOPIXELS) ? MappedImageFile::HeaderOnly : MappedImageFile::WholeFile);
+    const FREE_IMAGE_FORMAT fif = detectImageFormat_f(path, file);
     if ((fif != FIF_UNKNOWN) && FreeImage_FIFSupportsReading(fif)) {
-        FIBITMAP *dib = FreeImage_Load(fif, pc, flags);
+        FIBITMAP *dib = file.load(fif, flags);
         return dib;
     }
     return nullptr;
@@ -636,6 +992,8 @@ UNIONIMAGESHARED_EXPORT bool writeFIBITMAPToFile(FIBITMAP *dib, const QString &p
 //}
 
 QString PrivateDetectImageFormat(const QString &filepath);
+QString PrivateDetectImageFormat(const QByteArray &data);
+
 UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString& path, QImage &res, QString &errorMsg, const QString &format_bar)
 {
     /*lmh0806判断后缀名是不支持格式，直接返回空的Image*/
@@ -649,11 +1007,18 @@ UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString& path, QImage
         }
     }
 
+    //文件只打开映射一次，格式检测、Qt解码和FreeImage解码共用同一份映射，网络文件系统上不再反复打开
+    MappedImageFile file(path);
+    if (!file.isOpen()) {
+        errorMsg = "can't open file:" + file.errorString() + " ,path:" + path;
+        res = QImage();
+        return false;
+    }
+    const QByteArray &data = file.data();
+
     QFileInfo file_info(path);
     QString file_suffix_upper = file_info.suffix().toUpper();
-    QByteArray temp_path;
-    temp_path.append(path.toUtf8());
-    FREE_IMAGE_FORMAT f = FreeImage_GetFileType(temp_path.data());
+    FREE_IMAGE_FORMAT f = file.fileType();
     if (f != FIF_UNKNOWN && f != union_image_private.m_freeimage_formats[file_suffix_upper]) {
         file_suffix_upper = union_image_private.m_freeimage_formats.key(f);
     }
@@ -662,9 +1027,19 @@ UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString& path, QImage
     }
     QString file_suffix_lower = file_suffix_upper.toLower();
     if (f==FIF_RAW ||union_image_private.m_qtSupported.contains(file_suffix_upper)) {
-        QImageReader reader;
+        //映射内容完整时从内存读取，超过2GB等无法整体读入的文件按路径读取
+        QBuffer buffer;
+        QFile source(path);
+        QIODevice *device = &buffer;
+        if (file.isComplete()) {
+            buffer.setData(data);
+            buffer.open(QIODevice::ReadOnly);
+        } else {
+            source.open(QIODevice::ReadOnly);
+            device = &source;
+        }
+        QImageReader reader(device);
         QImage res_qt;
-        reader.setFileName(path);
         if (format_bar.isEmpty()) {
             reader.setFormat(file_suffix_lower.toLatin1());
         } else {
@@ -675,15 +1050,16 @@ UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString& path, QImage
             res_qt = reader.read();
             if (res_qt.isNull()) {
                 //try old loading method
-                QString format = PrivateDetectImageFormat(path);
-                QImageReader readerF(path, format.toLatin1());
+                QString format = file.isComplete() ? PrivateDetectImageFormat(data) : PrivateDetectImageFormat(path);
+                device->seek(0);
+                QImageReader readerF(device, format.toLatin1());
                 QImage try_res;
                 readerF.setAutoTransform(true);
                 if (readerF.canRead()) {
                     try_res = readerF.read();
                 } else {
                     errorMsg = "can't read image:" + readerF.errorString() + format;
-                    try_res = QImage(path);
+                    try_res = file.isComplete() ? QImage::fromData(data) : QImage(path);
                 }
                 if (try_res.isNull()) {
                     errorMsg = "load image by qt faild, use format:" + reader.format() + " ,path:" + path;
@@ -706,9 +1082,14 @@ UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString& path, QImage
         if (f != FREE_IMAGE_FORMAT::FIF_UNKNOWN || union_image_private.m_freeimage_formats.contains(file_suffix_upper)) {
             if (f == FREE_IMAGE_FORMAT::FIF_UNKNOWN)
                 f = FREE_IMAGE_FORMAT(union_image_private.m_freeimage_formats[file_suffix_upper]);
-            FIBITMAP *dib = FreeImage_Load(f, temp_path.data());
+            takeFreeImageError();
+            FIBITMAP *dib = file.load(f);
             if (nullptr == dib) {
-                errorMsg = "image load faild, format:" + union_image_private.m_freeimage_formats.key(f) + " ,path:" + temp_path;
+                errorMsg = "image load faild, format:" + union_image_private.m_freeimage_formats.key(f) + " ,path:" + path;
+                const QString freeimageError = takeFreeImageError();
+                if (!freeimageError.isEmpty()) {
+                    errorMsg += " ," + freeimageError;
+                }
                 //FreeImage_Unload(dib);
                 res = QImage();
                 return false;
@@ -716,14 +1097,13 @@ UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString& path, QImage
 //            uint depth = FreeImage_GetBPP(dib); //just for test
 //            Q_UNUSED(depth);
             //32位以上图片qImage不支持,强行读取和转换可能会乱码
-            res = QImage(FIBitmap2QImage(dib));
+            //位图交给QImage管理，32位和64位图片不再复制一份像素
+            res = wrapFIBitmap2QImage(dib);
             if (res.isNull()) {
-                errorMsg = "convert to QImage faild" + union_image_private.m_freeimage_formats.key(f) + " ,path:" + temp_path;
-                FreeImage_Unload(dib);
+                errorMsg = "convert to QImage faild" + union_image_private.m_freeimage_formats.key(f) + " ,path:" + path;
                 res = QImage();
                 return false;
             }
-            FreeImage_Unload(dib);
             errorMsg = "";
             return true;
         }
@@ -830,12 +1210,16 @@ UNIONIMAGESHARED_EXPORT QString detectImageFormat(const QString &path)
 }
 
 FREE_IMAGE_FORMAT detectImageFormat_f(const QString &path)
+{
+    MappedImageFile file(path, MappedImageFile::HeaderOnly);
+    return detectImageFormat_f(path, file);
+}
+
+static FREE_IMAGE_FORMAT detectImageFormat_f(const QString &path, MappedImageFile &file)
 {
     QFileInfo file_info(path);
     QString file_suffix_upper = file_info.suffix().toUpper();
-    QByteArray temp_path;
-    temp_path.append(path.toUtf8());
-    FREE_IMAGE_FORMAT f = FreeImage_GetFileType(temp_path.data());
+    FREE_IMAGE_FORMAT f = file.fileType();
     if (f != FIF_UNKNOWN && f != union_image_private.m_freeimage_formats[file_suffix_upper]) {
         file_suffix_upper = union_image_private.m_freeimage_formats.key(f);
     }
@@ -843,13 +1227,12 @@ FREE_IMAGE_FORMAT detectImageFormat_f(const QString &path)
         file_suffix_upper = "TIFF";
     }
     if (file_suffix_upper.isEmpty()) {
-        QFile file(path);
-        if (!file.open(QIODevice::ReadOnly)) {
+        if (!file.isOpen()) {
             return FIF_UNKNOWN;
         }
 
         //    const QByteArray data = file.read(1024);
-        const QByteArray data = file.read(64);
+        const QByteArray data = file.data().left(64);
 
         // Check bmp file.
         if (data.startsWith("BM")) {
@@ -959,6 +1342,52 @@ UNIONIMAGESHARED_EXPORT bool rotateImage(int angel, QImage &image)
     return false;
 }
 
+/*
+ * JPEG在DCT域无损旋转，不解码也不重新压缩，其余标记段（EXIF等）原样保留。
+ * 宽高不是MCU整数倍时无法无损旋转，返回false由调用方改用解码旋转
+ */
+static bool rotateJpegLossless(int angel, const QString &path)
+{
+    FREE_IMAGE_JPEG_OPERATION operation;
+    switch (((angel % 360) + 360) % 360) {
+    case 90:
+        operation = FIJPEG_OP_ROTATE_90;
+        break;
+    case 180:
+        operation = FIJPEG_OP_ROTATE_180;
+        break;
+    case 270:
+        operation = FIJPEG_OP_ROTATE_270;
+        break;
+    default:
+        return true;
+    }
+    //先写到同目录的临时文件，成功后再原子替换原图，失败时原图不受影响
+    const QFileInfo info(path);
+    const QString tempPath = info.absolutePath() + "/." + info.fileName() + ".rotate";
+    const QByteArray src = QFile::encodeName(path);
+    const QByteArray dst = QFile::encodeName(tempPath);
+    if (!FreeImage_JPEGTransform(src.constData(), dst.constData(), operation, TRUE)) {
+        QFile::remove(tempPath);
+        return false;
+    }
+    if (::rename(dst.constData(), src.constData()) != 0) {
+        QFile::remove(tempPath);
+        return false;
+    }
+    return true;
+}
+
+UNIONIMAGESHARED_EXPORT bool rotateImageFileByOrientationTag(int angel, const QString &path)
+{
+    if (angel % 90 != 0 || !union_image_private.m_rotateByOrientationTag.load())
+        return false;
+    const int fif = union_image_private.m_freeimage_formats.value(detectImageFormat(path), FIF_UNKNOWN);
+    if (fif != FIF_JPEG && fif != FIF_TIFF)
+        return false;
+    return utils::image::rotateOrientationTag(path, angel);
+}
+
 UNIONIMAGESHARED_EXPORT bool rotateImageFIle(int angel, const QString &path, QString &erroMsg)
 {
     if (angel % 90 != 0) {
@@ -996,8 +1425,15 @@ UNIONIMAGESHARED_EXPORT bool rotateImageFIle(int angel, const QString &path, QSt
         generator.setSize(QSize(image_copy.width(), image_copy.height()));
         rotatePainter.end();
         return true;
+    } else if (rotateImageFileByOrientationTag(angel, path)) {
+        erroMsg = "";
+        return true;
+    } else if (union_image_private.m_freeimage_formats.value(format) == FIF_JPEG && rotateJpegLossless(angel, path)) {
+        erroMsg = "";
+        return true;
     } else if (union_image_private.m_qtrotate.contains(format)) {
-        QPixmap image_copy(path);
+        //旋转可能在后台线程写入，不能使用QPixmap
+        QImage image_copy(path);
         if (!image_copy.isNull()) {
             QMatrix rotatematrix;
             rotatematrix.rotate(angel);
@@ -1139,10 +1575,6 @@ UNIONIMAGESHARED_EXPORT bool rotateImageFIle(int angel, const QString &path, QSt
 
 UNIONIMAGESHARED_EXPORT QMap<QString, QString> getAllMetaData(const QString &path)
 {
-    QMutexLocker mutex(&union_image_private.freeimage_mutex);
-
-    //qDebug() << "threadid:" << QThread::currentThread() << "getAllMetaData locking ....";
-
     FIBITMAP *dib = readFile2FIBITMAP(path, FIF_LOAD_NOPIXELS);
     QMap<QString, QString> admMap;
     admMap.unite(getMetaData(FIMD_EXIF_MAIN, dib));
@@ -1198,7 +1630,6 @@ UNIONIMAGESHARED_EXPORT QMap<QString, QString> getAllMetaData(const QString &pat
     admMap.insert("FileFormat", getFileFormat(path));
     admMap.insert("FileSize", size2Human(info.size()));
     FreeImage_Unload(dib);
-    //qDebug() <<  QThread::currentThread() << "getAllMetaData lock end";
     return admMap;
 }
 
@@ -1223,11 +1654,8 @@ UNIONIMAGESHARED_EXPORT const QString getOrientation(const QString &path)
 {
     FIBITMAP *dib = readFile2FIBITMAP(path, FIF_LOAD_NOPIXELS);
     auto datas = getMetaData(FIMD_EXIF_MAIN, dib);
-    if (datas.isEmpty()) {
-        return QString();
-    }
     FreeImage_Unload(dib);
-    return datas["Orientation"];
+    return datas.value("Orientation");
 }
 
 bool getThumbnail(QImage &res, const QString &path)
@@ -1246,7 +1674,15 @@ QString PrivateDetectImageFormat(const QString &filepath)
         return "";
     }
 
-    const QByteArray data = file.read(1024);
+    return PrivateDetectImageFormat(file.read(1024));
+}
+
+/*
+ * 按文件头判断格式，只检查前1KB，调用方已读入的数据可直接传入
+ */
+QString PrivateDetectImageFormat(const QByteArray &fileData)
+{
+    const QByteArray data = fileData.left(1024);
 
     // Check bmp file.
     if (data.startsWith("BM")) {
@@ -38,6 +38,8 @@
 #include <QMap>
 #include <FreeImage.h>
 
+#include "pixelconvert.h"
+
 namespace  UnionImage_NameSpace {
 
 enum SupportType {
@@ -120,6 +122,50 @@ UNIONIMAGESHARED_EXPORT bool isDynamicFormat();
  */
 UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString& path, QImage &res, QString &errorMsg, const QString &format_bar = "");
 
+/**
+ * @brief FIBitmap2QImage
+ * @param[in]           dib
+ * @return QImage
+ * 由FreeImage位图转为QImage，8位每通道转为(A)RGB32，16位每通道转为RGBX64（带alpha时为RGBA64），
+ * 浮点图色调映射后转为(A)RGB32
+ */
+UNIONIMAGESHARED_EXPORT QImage FIBitmap2QImage(FIBITMAP *dib);
+
+/**
+ * @brief wrapFIBitmap2QImage
+ * @param[in]           dib
+ * @return QImage
+ * 接管FreeImage位图的所有权，调用后不要再使用或释放dib。
+ * 32位和RGBA16位图原地翻转后直接作为QImage的像素内存，最后一个QImage副本销毁时释放位图；
+ * 其余格式转换后立即释放
+ */
+UNIONIMAGESHARED_EXPORT QImage wrapFIBitmap2QImage(FIBITMAP *dib);
+
+/**
+ * @brief setHdrDisplay
+ * @param[in]           toneMapOperator     浮点图的色调映射方式，见utils::image::ToneMapOperator
+ * @param[in]           exposureStops       显示曝光（档），限制在±4档
+ * 设置高位深图片的显示方式，色调映射在解码时生效，曝光在toDisplayImage时生效
+ */
+UNIONIMAGESHARED_EXPORT void setHdrDisplay(int toneMapOperator, qreal exposureStops);
+
+/**
+ * @brief setRotateByOrientationTag
+ * @param[in]           enable
+ * 开启时（默认）带有EXIF方向标签的JPEG/TIFF旋转只改写方向标签，不重新编码像素；
+ * 关闭或文件中没有方向标签时按原来的方式旋转像素
+ */
+UNIONIMAGESHARED_EXPORT void setRotateByOrientationTag(bool enable);
+
+/**
+ * @brief toDisplayImage
+ * @param[in]           image
+ * @return QImage
+ * 高位深（RGBX64/RGBA64）图片按当前曝光转为8位的RGB32/ARGB32，8位图片原样返回。
+ * 应在缩放到显示或缩略图尺寸之后调用，只转换最终需要的像素
+ */
+UNIONIMAGESHARED_EXPORT QImage toDisplayImage(const QImage &image);
+
 /**
  * @brief detectImageFormat
  * @param path
@@ -161,6 +207,16 @@ UNIONIMAGESHARED_EXPORT bool rotateImage(int angel, QImage &image);
  */
 UNIONIMAGESHARED_EXPORT bool rotateImageFIle(int angel, const QString &path, QString &erroMsg);
 
+/**
+ * @brief rotateImageFileByOrientationTag
+ * @param[in]           angel
+ * @param[in]           path
+ * @return bool
+ * 开启只改写方向标签、且文件是带方向标签的JPEG/TIFF时，原地改写标签并返回true；
+ * 否则不修改文件，返回false
+ */
+UNIONIMAGESHARED_EXPORT bool rotateImageFileByOrientationTag(int angel, const QString &path);
+
 ///**
 // * @brief rotateImageFIle
 // * @param[in]           angel
@@ -184,6 +240,14 @@ UNIONIMAGESHARED_EXPORT bool rotateImageFIle(int angel, const QString &path, QSt
  */
 UNIONIMAGESHARED_EXPORT QMap<QString, QString> getAllMetaData(const QString &path);
 
+/**
+ * @brief size2Human
+ * @param bytes
+ * @return QString
+ * 文件大小转化为可读的字符串
+ */
+UNIONIMAGESHARED_EXPORT QString size2Human(const qlonglong bytes);
+
 /**
  * @brief isImageSupportRotate
  * @param path
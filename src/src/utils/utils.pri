@@ -4,12 +4,16 @@ HEADERS += \
     $$PWD/shortcut.h \
     $$PWD/imageutils_freeimage.h \
     $$PWD/imageutils_libexif.h \
+    $$PWD/metadatareader.h \
+    $$PWD/pixelconvert.h \
     $$PWD/snifferimageformat.h \
     $$PWD/unionimage.h \
 #    $$PWD/giflib/cmanagerattributeservice.h
 
 SOURCES += \
     $$PWD/imageutils.cpp \
+    $$PWD/metadatareader.cpp \
+    $$PWD/pixelconvert.cpp \
     $$PWD/baseutils.cpp \
     $$PWD/shortcut.cpp \
     $$PWD/snifferimageformat.cpp \
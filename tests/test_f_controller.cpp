@@ -2,7 +2,10 @@
 #include "accessibility/ac-desktop-define.h"
 #include "src/src/controller/dbusclient.h"
 #include "src/src/controller/divdbuscontroller.h"
+#include <QSemaphore>
+#include <QtConcurrent>
 #define private public
+#include "src/src/controller/rotationwriter.h"
 #include "src/src/controller/wallpapersetter.h"
 
 TEST_F(gtestview, Dbusclient1)
@@ -75,3 +78,53 @@ TEST_F(gtestview, collectSubDirs)
 //    tt.wait(2000);
 //    ct.wait(2000);
 }
+TEST_F(gtestview, rotationWriterCoalesce)
+{
+    //同一文件的多次旋转合并为一次写入，转回原方向时不写入
+    RotationWriter *writer = RotationWriter::instance();
+    const QString path = QDir::tempPath() + "/rotation_writer.png";
+    QImage image(32, 16, QImage::Format_RGB32);
+    image.fill(Qt::white);
+    //左上角做标记，用来区分顺时针90度和270度
+    image.setPixel(0, 0, qRgb(255, 0, 0));
+    image.setPixel(1, 0, qRgb(255, 0, 0));
+    image.setPixel(0, 1, qRgb(255, 0, 0));
+    image.setPixel(1, 1, qRgb(255, 0, 0));
+    ASSERT_TRUE(image.save(path, "PNG"));
+
+    writer->waitForDone();
+    QAtomicInt writes;
+    const QMetaObject::Connection counter = QObject::connect(writer, &RotationWriter::progressChanged,
+                                                             [&writes](int, int) {
+        writes.ref();
+    });
+    //写入线程只有一个，先占住它，保证三次旋转都在写入开始之前加入队列
+    QSemaphore busy;
+    QtConcurrent::run(&writer->m_pool, [&busy] { busy.acquire(); });
+    writer->enqueue(path, 90);
+    writer->enqueue(path, 90);
+    writer->enqueue(path, 90);
+    {
+        QMutexLocker locker(&writer->m_mutex);
+        EXPECT_EQ(writer->m_order, QStringList() << path);
+        EXPECT_EQ(writer->m_pending.value(path), 270);
+    }
+    busy.release();
+    writer->waitForDone();
+    EXPECT_EQ(writes.load(), 1);
+    const QImage rotated(path);
+    EXPECT_EQ(rotated.size(), QSize(16, 32));
+    //顺时针270度后原来的左上角在左下角
+    EXPECT_EQ(rotated.pixel(0, 31), qRgb(255, 0, 0));
+
+    QtConcurrent::run(&writer->m_pool, [&busy] { busy.acquire(); });
+    writer->enqueue(path, 90);
+    writer->enqueue(path, -90);
+    busy.release();
+    writer->waitForDone();
+    EXPECT_TRUE(writer->isIdle());
+    EXPECT_EQ(writes.load(), 1);
+    EXPECT_EQ(QImageReader(path).size(), QSize(16, 32));
+    QObject::disconnect(counter);
+    QFile::remove(path);
+}
@@ -4,9 +4,13 @@
 #include "module/slideshow/slideeffectplayer.h"
 
 #include "module/slideshow/slideeffect.h"
+#include "module/slideshow/slideimagecache.h"
+#include "module/slideshow/slideregioncompositor.h"
 #include "module/slideshow/slideshowpanel.h"
 #include "module/slideshow/slideshowbottombar.h"
 #include "module/view/scen/imageview.h"
+#include <QElapsedTimer>
+#include <QPainter>
 TEST_F(gtestview, Sslideshowpanel1)
 {
     SlideShowPanel *panel=new SlideShowPanel();
@@ -64,6 +68,114 @@ TEST_F(gtestview, SlideEffect_Circle_1)
     m_effect=nullptr;
 }
 
+TEST_F(gtestview, SlideRegionCompositor_bench)
+{
+    //各切换效果在1080p和4K下，区域合成与QPainter裁剪绘制的单帧耗时对比，结果需完全一致
+    const QStringList effects = {"blinds_left_to_right", "horizontal_open", "enter_from_right", "ellipse_open"};
+    const QList<QSize> sizes = {QSize(1920, 1080), QSize(3840, 2160)};
+    for (const QSize &size : sizes) {
+        QImage current(size, QImage::Format_ARGB32);
+        current.fill(Qt::red);
+        QImage next(size, QImage::Format_ARGB32);
+        next.fill(Qt::blue);
+        for (const QString &id : effects) {
+            SlideEffect *effect = SlideEffect::create(id);
+            ASSERT_TRUE(effect != nullptr);
+            effect->setSize(size);
+            effect->setImages(current, next);
+            effect->prepare();
+            while (effect->prepareNextFrame()) {
+            }
+
+            QImage painterFrame(size, QImage::Format_ARGB32);
+            QImage regionFrame(size, QImage::Format_ARGB32);
+            qint64 painterNs = 0;
+            qint64 regionNs = 0;
+            QElapsedTimer timer;
+            for (const SlideEffectFrame &frame : effect->m_frames) {
+                timer.start();
+                painterFrame.fill(Qt::transparent);
+                QPainter p(&painterFrame);
+                p.setClipRegion(frame.current_region);
+                p.drawImage(QRect(QPoint(0, 0), size), *effect->current_image, frame.current_rect);
+                p.setClipRegion(frame.next_region);
+                p.drawImage(QRect(QPoint(0, 0), size), *effect->next_image, frame.next_rect);
+                p.end();
+                painterNs += timer.nsecsElapsed();
+
+                timer.start();
+                QPoint currentOffset;
+                QPoint nextOffset;
+                ASSERT_TRUE(SlideRegionCompositor::sourceOffset(regionFrame, *effect->current_image, frame.current_rect, &currentOffset));
+                ASSERT_TRUE(SlideRegionCompositor::sourceOffset(regionFrame, *effect->next_image, frame.next_rect, &nextOffset));
+                SlideRegionCompositor::clear(regionFrame, QRegion(regionFrame.rect()) - frame.current_region - frame.next_region);
+                SlideRegionCompositor::composite(regionFrame, *effect->current_image, currentOffset, frame.current_region);
+                SlideRegionCompositor::composite(regionFrame, *effect->next_image, nextOffset, frame.next_region);
+                regionNs += timer.nsecsElapsed();
+
+                EXPECT_TRUE(painterFrame == regionFrame);
+            }
+            //单帧耗时（微秒）记入测试结果（--gtest_output=xml），不作为断言条件
+            int frames = qMax(1, effect->m_frames.size());
+            const QString key = QString("%1_%2x%3").arg(id).arg(size.width()).arg(size.height());
+            RecordProperty((key + "_painter_us").toStdString(), static_cast<int>(painterNs / 1000 / frames));
+            RecordProperty((key + "_region_us").toStdString(), static_cast<int>(regionNs / 1000 / frames));
+            delete effect;
+        }
+    }
+}
+
+TEST_F(gtestview, SlideImageCacheBudget)
+{
+    //缓存窗口：当前、后面K张和上一张；超出预算时先释放最远的预读图片，
+    //当前、上一张和下一张保留，释放后按实际大小缩小窗口，不会反复解码
+    QStringList paths;
+    for (int i = 0; i < 6; i++) {
+        const QString path = QDir::tempPath() + QString("/slide_cache_%1.png").arg(i);
+        QImage image(64, 64, QImage::Format_RGB32);
+        image.fill(QColor(i * 40, 0, 0));
+        ASSERT_TRUE(image.save(path, "PNG"));
+        paths << path;
+    }
+    const qint64 imageBytes = 64 * 64 * 4;
+
+    SlideImageCache cache;
+    cache.setDecodeSize(QSize(64, 64));
+    cache.setLookAhead(3);
+    cache.setMemoryBudget(imageBytes * 4 + imageBytes / 2);
+    EXPECT_EQ(cache.effectiveLookAhead(), 2);
+    cache.prefetch(paths, 2);
+    for (int i = 0; i < 100 && !cache.m_pending.isEmpty(); i++) {
+        QTest::qWait(20);
+    }
+    ASSERT_TRUE(cache.m_pending.isEmpty());
+    EXPECT_EQ(cache.count(), 4);
+    EXPECT_TRUE(cache.contains(paths[1]));
+    EXPECT_TRUE(cache.contains(paths[2]));
+    EXPECT_TRUE(cache.contains(paths[3]));
+    EXPECT_TRUE(cache.contains(paths[4]));
+    EXPECT_FALSE(cache.contains(paths[5]));
+    EXPECT_LE(cache.cachedBytes(), cache.memoryBudget());
+
+    //解码结果比估算的大：释放最远的预读图片并移出窗口
+    cache.insert(paths[4], QImage(128, 128, QImage::Format_RGB32));
+    EXPECT_LE(cache.cachedBytes(), cache.memoryBudget());
+    EXPECT_FALSE(cache.contains(paths[4]));
+    EXPECT_FALSE(cache.m_window.contains(paths[4]));
+    EXPECT_TRUE(cache.contains(paths[1]));
+    EXPECT_TRUE(cache.contains(paths[2]));
+    EXPECT_TRUE(cache.contains(paths[3]));
+
+    //再次预读时窗口按实际大小缩小，不再解码被释放的图片
+    EXPECT_EQ(cache.effectiveLookAhead(), 1);
+    cache.prefetch(paths, 2);
+    EXPECT_TRUE(cache.m_pending.isEmpty());
+    EXPECT_EQ(cache.count(), 3);
+
+    for (const QString &path : paths) {
+        QFile::remove(path);
+    }
+}
 
 TEST_F(gtestview, PanelTest)
 {
@@ -1,11 +1,12 @@
 #define private public
 #include "src/src/module/view/contents/ttlcontent.h"
+#include "src/src/module/view/contents/ttbcontent.h"
 #include "widgets/pushbutton.h"
 #undef private
 #include "gtestview.h"
 #include "accessibility/ac-desktop-define.h"
-#include "src/src/module/view/contents/ttbcontent.h"
 
+#include <QElapsedTimer>
 #include <QEvent>
 #include <QGesture>
 #include <QPinchGesture>
@@ -347,4 +348,152 @@ TEST_F(gtestview,emitupdateTopToolbar)
 {
     emit dApp->signalM->updateTopToolbar();
 }
+
+TEST_F(gtestview,ImageItemFlickPaintCost)
+{
+    //模拟快速拖动缩略图栏，状态不变时重绘只贴预先绘制好的圆角缩略图
+    DWidget strip;
+    QList<ImageItem *> items;
+    strip.resize(60 * 32 + 26, 60);
+    QPixmap pix(":/jpg.jpg");
+    for (int i = 0; i < 60; i++) {
+        ImageItem *item = new ImageItem(i, QString("flick%1").arg(i), nullptr, &strip);
+        item->setIndexNow(30);
+        if (i == 30) {
+            item->setGeometry(i * 32, 1, 58, 58);
+        } else {
+            item->setGeometry(i * 32 + (i > 30 ? 26 : 0), 10, 32, 40);
+        }
+        item->updatePic(pix);
+        items << item;
+    }
+    strip.show();
+    strip.repaint();
+
+    QList<qint64> keys;
+    for (ImageItem *item : items) {
+        ASSERT_FALSE(item->m_renderCache.isNull());
+        keys << item->m_renderCache.cacheKey();
+    }
+    //耗时记入测试结果（--gtest_output=xml），不作为断言条件
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame = 0; frame < 100; frame++) {
+        strip.move(-(frame % 50) * 16, 0);
+        strip.repaint();
+    }
+    RecordProperty("flick_repaint_100_ms", static_cast<int>(timer.elapsed()));
+    for (int i = 0; i < items.size(); i++) {
+        EXPECT_EQ(items.at(i)->m_renderCache.cacheKey(), keys.at(i));
+    }
+}
+
+TEST_F(gtestview,TTBContentVisibleItemsBounded)
+{
+    //两万张图片时只为可视区域两侧少量图元创建控件，拖动缩略图栏时控件总数不随图片数增长
+    if(!m_frameMainWindow){
+        m_frameMainWindow = CommandLine::instance()->getMainWindow();
+    }
+    ViewPanel *panel = m_frameMainWindow->findChild<ViewPanel *>(VIEW_PANEL_WIDGET);
+    if(!panel)
+        return;
+
+    DBImgInfoList infos;
+    for (int i = 0; i < 20000; i++) {
+        DBImgInfo info;
+        info.filePath = QString("/tmp/strip%1.jpg").arg(i);
+        info.fileName = QString("strip%1.jpg").arg(i);
+        infos << info;
+    }
+    TTBContent *content = new TTBContent(false, infos, false, panel);
+    content->m_imgList->setFixedSize((infos.size() + 1) * 32, content->m_imgList->height());
+    content->m_nowIndex = 10000;
+    content->m_layoutIndex = -1;
+
+    //可视宽度内的图元加上两侧各8个预留图元
+    int bound = content->m_imgListView->width() / 32 + 2 * 8 + 2;
+    for (int x = 0; x < infos.size() * 32; x += 997) {
+        content->m_imgList->move(-x, content->m_imgList->y());
+        content->updateVisibleItems();
+        ASSERT_FALSE(content->m_visibleItems.isEmpty());
+        EXPECT_LE(content->m_visibleItems.size() + content->m_freeItems.size(), bound);
+    }
+    delete content;
+}
+
+TEST_F(gtestview,TTBContentPathItems)
+{
+    //按路径查找的图元与按索引定位的可见图元一致，移出可视区域后不再能查到
+    if(!m_frameMainWindow){
+        m_frameMainWindow = CommandLine::instance()->getMainWindow();
+    }
+    ViewPanel *panel = m_frameMainWindow->findChild<ViewPanel *>(VIEW_PANEL_WIDGET);
+    if(!panel)
+        return;
+
+    DBImgInfoList infos;
+    for (int i = 0; i < 500; i++) {
+        DBImgInfo info;
+        info.filePath = QString("/tmp/lookup%1.jpg").arg(i);
+        info.fileName = QString("lookup%1.jpg").arg(i);
+        infos << info;
+    }
+    TTBContent *content = new TTBContent(false, infos, false, panel);
+    content->m_imgList->setFixedSize((infos.size() + 1) * 32, content->m_imgList->height());
+    content->m_nowIndex = 250;
+    content->m_layoutIndex = -1;
+    content->m_imgList->move(-250 * 32, content->m_imgList->y());
+    content->updateVisibleItems();
+
+    ASSERT_EQ(content->m_pathItems.size(), content->m_visibleItems.size());
+    for (auto it = content->m_visibleItems.begin(); it != content->m_visibleItems.end(); ++it) {
+        ImageItem *item = content->m_pathItems.value(infos.at(it.key()).filePath);
+        ASSERT_EQ(item, it.value());
+        EXPECT_EQ(item->getIndex(), it.key());
+    }
+    EXPECT_EQ(content->m_pathItems.value(infos.at(250).filePath)->getIndex(), 250);
+    EXPECT_EQ(content->m_pathItems.value(infos.at(0).filePath), nullptr);
+
+    //滚回开头后，复用的控件绑定到新路径
+    content->m_imgList->move(0, content->m_imgList->y());
+    content->updateVisibleItems();
+    ImageItem *first = content->m_pathItems.value(infos.at(0).filePath);
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(first->getIndex(), 0);
+    EXPECT_EQ(first->getPath(), infos.at(0).filePath);
+    EXPECT_EQ(content->m_pathItems.value(infos.at(250).filePath), nullptr);
+    delete content;
+}
+
+TEST_F(gtestview,MyImageListWidgetIndexAtMiddle)
+{
+    //选中项10宽58，占[320,378)，其后图元右移26
+    MyImageListWidget view;
+    DWidget *list = new DWidget(&view);
+    view.setObj(list);
+    view.resize(400, 70);
+    list->resize(101 * 32, 60);
+    view.setItemCount(100);
+    view.setCurrentIndex(10);
+
+    //视口中线位于200，列表左移后中线落在列表坐标200-x处
+    auto indexAt = [&](int middle) {
+        list->move(200 - middle, 0);
+        return view.indexAtMiddle();
+    };
+    EXPECT_EQ(indexAt(0), 0);
+    EXPECT_EQ(indexAt(319), 9);
+    EXPECT_EQ(indexAt(320), 10);
+    EXPECT_EQ(indexAt(377), 10);
+    EXPECT_EQ(indexAt(378), 11);
+    EXPECT_EQ(indexAt(409), 11);
+    EXPECT_EQ(indexAt(410), 12);
+    EXPECT_EQ(indexAt(99 * 32 + 26), 99);
+    EXPECT_EQ(indexAt(100 * 32 + 26), -1);
+    EXPECT_EQ(indexAt(-1), -1);
+
+    //无选中项时按等宽图元计算
+    view.setCurrentIndex(-1);
+    EXPECT_EQ(indexAt(378), 11);
+}
 #endif
@@ -5,7 +5,13 @@
 #include <QMouseEvent>
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#define private public
 #include "module/view/scen/imageview.h"
+#include "module/view/scen/graphicsitem.h"
+#include "module/view/scen/imagesvgitem.h"
+#include <QGraphicsScene>
+#include <QSvgRenderer>
 #ifdef test_module_view_scen
 TEST_F(gtestview, showVagueImage)
 {
@@ -156,5 +162,143 @@ TEST_F(gtestview, QWheelEvent_1)
     }
 }
 
+//统计背景实际绘制的次数
+class BackgroundCountingView : public ImageView
+{
+public:
+    int backgroundPaints = 0;
+
+protected:
+    void drawBackground(QPainter *painter, const QRectF &rect) override
+    {
+        backgroundPaints++;
+        ImageView::drawBackground(painter, rect);
+    }
+};
+
+//40MP大图显示时，浮动窗口区域的局部刷新使用缓存的背景，不重新填充背景
+TEST_F(gtestview, repaintCost_40MP)
+{
+    BackgroundCountingView *view = new BackgroundCountingView();
+    view->resize(1280, 720);
+    view->show();
+
+    QImage img(7680, 5200, QImage::Format_RGB32);
+    img.fill(Qt::darkCyan);
+    GraphicsPixmapItem *item = new GraphicsPixmapItem(QPixmap::fromImage(img));
+    item->setTransformationMode(Qt::SmoothTransformation);
+    view->scene()->addItem(item);
+    view->setSceneRect(item->boundingRect());
+    view->fitWindow();
+    QTest::qWait(50);
+    EXPECT_EQ(view->viewportUpdateMode(), QGraphicsView::SmartViewportUpdate);
+    EXPECT_TRUE(view->cacheMode().testFlag(QGraphicsView::CacheBackground));
+
+    //首次绘制填充背景缓存
+    view->viewport()->repaint();
+    view->backgroundPaints = 0;
+
+    //耗时记入测试结果（--gtest_output=xml），不作为断言条件
+    const QRect overlayRect(view->width() - 80, view->height() / 2 - 50, 70, 140);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < 20; i++) {
+        view->scene()->update(view->mapToScene(overlayRect).boundingRect());
+        QCoreApplication::processEvents();
+    }
+    RecordProperty("overlay_repaint_20_ms", static_cast<int>(timer.elapsed()));
+    EXPECT_EQ(view->backgroundPaints, 0);
+
+    //缓存失效（如主题切换）后才重新填充
+    view->resetCachedContent();
+    view->viewport()->repaint();
+    EXPECT_GT(view->backgroundPaints, 0);
+
+    delete view;
+    view = nullptr;
+}
+
+//旋转只改变图元的显示方向，外接矩形仍从场景原点开始，原图像素不变
+TEST_F(gtestview, pixmapItemOrientation)
+{
+    GraphicsPixmapItem item(QPixmap(40, 20));
+    item.setOrientation(90);
+    EXPECT_EQ(item.sceneBoundingRect(), QRectF(0, 0, 20, 40));
+    EXPECT_EQ(item.pixmap().size(), QSize(40, 20));
+    EXPECT_EQ(item.orientedImage().size(), QSize(20, 40));
+
+    item.setOrientation(item.orientation() - 180);
+    EXPECT_EQ(item.orientation(), 270);
+    EXPECT_EQ(item.sceneBoundingRect(), QRectF(0, 0, 20, 40));
+    item.setOrientation(360);
+    EXPECT_EQ(item.sceneBoundingRect(), QRectF(0, 0, 40, 20));
+}
+
+
+//放大8倍显示svg时，后台渲染的瓦片边缘清晰，不是默认尺寸图放大后的插值
+TEST_F(gtestview, imageSvgItemTiles)
+{
+    const QString path = QDir::tempPath() + "/svg_tiles.svg";
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"100\" height=\"50\">"
+               "<rect x=\"0\" y=\"0\" width=\"50\" height=\"50\" fill=\"black\"/></svg>");
+    file.close();
+
+    QImage preview(100, 50, QImage::Format_ARGB32_Premultiplied);
+    preview.fill(Qt::transparent);
+    QPainter previewPainter(&preview);
+    QSvgRenderer(path).render(&previewPainter);
+    previewPainter.end();
+
+    QGraphicsScene scene;
+    scene.addItem(new ImageSvgItem(path, QPixmap::fromImage(preview)));
+    QImage canvas(800, 400, QImage::Format_RGB32);
+    bool sharp = false;
+    for (int i = 0; i < 100 && !sharp; i++) {
+        canvas.fill(Qt::white);
+        QPainter painter(&canvas);
+        scene.render(&painter, QRectF(0, 0, 800, 400), QRectF(0, 0, 100, 50));
+        painter.end();
+        sharp = canvas.pixel(399, 200) == qRgb(0, 0, 0) && canvas.pixel(400, 200) == qRgb(255, 255, 255);
+        QTest::qWait(20);
+    }
+    EXPECT_TRUE(sharp);
+    QFile::remove(path);
+}
+
+//动图边解码边播放，解码线程运行中销毁图元不会等待或崩溃
+TEST_F(gtestview, movieItemDecodeAhead)
+{
+    const QString path = QApplication::applicationDirPath() + "/gif.gif";
+    QGraphicsScene scene;
+    GraphicsMovieItem *item = new GraphicsMovieItem(path);
+    scene.addItem(item);
+    const QSize firstFrame = item->pixmap().size();
+    auto renderScene = [&scene, firstFrame] {
+        QImage canvas(firstFrame, QImage::Format_ARGB32_Premultiplied);
+        canvas.fill(Qt::transparent);
+        QPainter painter(&canvas);
+        scene.render(&painter);
+        painter.end();
+        return canvas;
+    };
+    item->start();
+    //gif.gif每帧50毫秒，300毫秒内应当已经播放了几帧
+    QTest::qWait(300);
+    EXPECT_GT(item->m_seq, 1);
+
+    const int seq = item->m_seq;
+    const QImage current = renderScene();
+    QTest::qWait(150);
+    EXPECT_GT(item->m_seq, seq);
+    const QImage next = renderScene();
+    EXPECT_NE(current, next);
+    item->stop();
+    EXPECT_EQ(item->pixmap().size(), firstFrame);
+
+    scene.removeItem(item);
+    delete item;
+}
 //还没有模拟手指事件
 #endif
@@ -1,4 +1,7 @@
 #include "gtestview.h"
+#include "utils/metadatareader.h"
+#include <QtConcurrent>
+#include <limits>
 
 //baseutils utils::base
 #ifdef test_utils
@@ -50,6 +53,26 @@ TEST_F(gtestview, getCreateDateTime)
     utils::image::getCreateDateTime(QApplication::applicationDirPath()+"/png.png");
 }
 
+TEST_F(gtestview, MetaDataCache)
+{
+    const QString path = QApplication::applicationDirPath() + "/jpg.jpg";
+    utils::image::MetaDataCache::instance()->remove(path);
+
+    //第二次查询命中缓存，结果与第一次相同
+    utils::image::ImageMetaData first = utils::image::imageMetaData(path);
+    utils::image::ImageMetaData second = utils::image::imageMetaData(path);
+    EXPECT_EQ(first.fields, second.fields);
+    EXPECT_EQ(first.size, second.size);
+    EXPECT_EQ(utils::image::readMetaData(path), first.fields);
+
+    utils::image::ImageMetaData cached;
+    EXPECT_TRUE(utils::image::MetaDataCache::instance()->find(QFileInfo(path), cached));
+
+    //不存在的文件不进入缓存
+    utils::image::imageMetaData("error");
+    EXPECT_FALSE(utils::image::MetaDataCache::instance()->find(QFileInfo("error"), cached));
+}
+
 TEST_F(gtestview, imageSupportRead)
 {
     utils::image::imageSupportRead("error");
@@ -178,6 +201,48 @@ TEST_F(gtestview, rotateImageFIle)
 
 }
 
+TEST_F(gtestview, rotateJpegLossless)
+{
+    //宽高为MCU整数倍的JPEG无损旋转，转回原方向后像素与原图完全一致
+    const QString path = QDir::tempPath() + "/rotate_lossless.jpg";
+    QImage source(64, 48, QImage::Format_RGB32);
+    for (int y = 0; y < source.height(); y++) {
+        for (int x = 0; x < source.width(); x++) {
+            source.setPixel(x, y, qRgb(x * 4, y * 5, (x + y) * 2));
+        }
+    }
+    ASSERT_TRUE(source.save(path, "JPG", 90));
+    const QImage before(path);
+
+    QString error;
+    EXPECT_TRUE(UnionImage_NameSpace::rotateImageFIle(90, path, error));
+    EXPECT_EQ(QImageReader(path).size(), QSize(48, 64));
+    EXPECT_TRUE(UnionImage_NameSpace::rotateImageFIle(-90, path, error));
+    EXPECT_EQ(QImage(path), before);
+    QFile::remove(path);
+}
+
+TEST_F(gtestview, rotateOrientationTag)
+{
+    //顺时针旋转90度：1->6->3->8->1，镜像方向2->7->4->5->2
+    EXPECT_EQ(utils::image::rotatedOrientation(1, 90), 6);
+    EXPECT_EQ(utils::image::rotatedOrientation(6, 180), 8);
+    EXPECT_EQ(utils::image::rotatedOrientation(8, -90), 3);
+    EXPECT_EQ(utils::image::rotatedOrientation(2, 90), 7);
+    EXPECT_EQ(utils::image::rotatedOrientation(5, 90), 2);
+    EXPECT_EQ(utils::image::rotatedOrientation(4, 360), 4);
+
+    //没有EXIF的文件不修改，由调用方改用像素旋转
+    const QString path = QDir::tempPath() + "/rotate_notag.jpg";
+    ASSERT_TRUE(QImage(16, 16, QImage::Format_RGB32).save(path, "JPG"));
+    const qint64 size = QFileInfo(path).size();
+    EXPECT_EQ(utils::image::readOrientationTag(path), 0);
+    EXPECT_FALSE(utils::image::rotateOrientationTag(path, 90));
+    EXPECT_EQ(QFileInfo(path).size(), size);
+    EXPECT_EQ(QImageReader(path).size(), QSize(16, 16));
+    QFile::remove(path);
+}
+
 //TEST_F(gtestview, rotateImageFIleWithImage)
 //{
 //    QString error;
@@ -274,6 +339,151 @@ TEST_F(gtestview, loadStaticImageFromFile)
 
 }
 
+TEST_F(gtestview, loadUnmappedLargeFile)
+{
+    //超过2GB的文件不做映射，格式检测只读文件头，解码按路径进行
+    const QString path = QDir::tempPath() + "/unmapped_large.png";
+    QImage source(24, 16, QImage::Format_RGB32);
+    source.fill(Qt::blue);
+    ASSERT_TRUE(source.save(path, "PNG"));
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+    //IEND之后补成稀疏文件，解码器读到IEND即结束
+    ASSERT_TRUE(file.resize(qint64(std::numeric_limits<int>::max()) + 4096));
+    file.close();
+
+    EXPECT_EQ(UnionImage_NameSpace::detectImageFormat_f(path), FIF_PNG);
+    QImage img;
+    QString error;
+    EXPECT_TRUE(UnionImage_NameSpace::loadStaticImageFromFile(path, img, error));
+    EXPECT_EQ(img.size(), source.size());
+    EXPECT_EQ(img.pixel(0, 0), source.pixel(0, 0));
+    QFile::remove(path);
+}
+
+TEST_F(gtestview, unionFreeImageParallel)
+{
+    //多线程同时解码和读取元数据，结果与单线程一致
+    const QStringList files = {
+        QApplication::applicationDirPath() + "/jpg.jpg",
+        QApplication::applicationDirPath() + "/tga.tga",
+        QApplication::applicationDirPath() + "/dds.dds",
+        QApplication::applicationDirPath() + "/png.png"
+    };
+    QMap<QString, QMap<QString, QString>> expectMeta;
+    QMap<QString, QSize> expectSize;
+    for (const QString &file : files) {
+        QImage img;
+        QString error;
+        UnionImage_NameSpace::loadStaticImageFromFile(file, img, error);
+        expectSize.insert(file, img.size());
+        expectMeta.insert(file, UnionImage_NameSpace::getAllMetaData(file));
+    }
+
+    QList<int> rounds;
+    for (int i = 0; i < 64; i++) {
+        rounds << i;
+    }
+    QAtomicInt mismatch;
+    QtConcurrent::blockingMap(rounds, [&](int i) {
+        const QString &file = files.at(i % files.size());
+        QImage img;
+        QString error;
+        UnionImage_NameSpace::loadStaticImageFromFile(file, img, error);
+        if (img.size() != expectSize.value(file)
+                || UnionImage_NameSpace::getAllMetaData(file) != expectMeta.value(file)) {
+            mismatch.ref();
+        }
+        UnionImage_NameSpace::getOrientation(file);
+        UnionImage_NameSpace::detectImageFormat(file);
+    });
+    EXPECT_EQ(mismatch.load(), 0);
+}
+
+TEST_F(gtestview, FIBitmap2QImageBenchmark)
+{
+    //与FreeImage_ConvertToRawBits的转换结果一致；耗时记入测试结果（--gtest_output=xml），不作为断言条件
+    const int width = 1920;
+    const int height = 1080;
+    const int rounds = 10;
+    FIBITMAP *dib = FreeImage_Allocate(width, height, 24);
+    for (int y = 0; y < height; y++) {
+        BYTE *line = FreeImage_GetScanLine(dib, static_cast<unsigned>(y));
+        for (int x = 0; x < width * 3; x++) {
+            line[x] = static_cast<BYTE>(x * 7 + y * 13);
+        }
+    }
+    QImage expect(width, height, QImage::Format_RGB32);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < rounds; i++) {
+        FreeImage_ConvertToRawBits(expect.scanLine(0), dib, static_cast<unsigned>(expect.bytesPerLine()), 32,
+                                   FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, true);
+    }
+    const qint64 freeimageMs = timer.restart();
+    QImage result;
+    for (int i = 0; i < rounds; i++) {
+        result = UnionImage_NameSpace::FIBitmap2QImage(dib);
+    }
+    RecordProperty("rgb24_freeimage_ms", static_cast<int>(freeimageMs));
+    RecordProperty("rgb24_kernel_ms", static_cast<int>(timer.elapsed()));
+    EXPECT_EQ(result, expect);
+    FreeImage_Unload(dib);
+
+    //16位和浮点图不再返回空图
+    FIBITMAP *rgb16 = FreeImage_AllocateT(FIT_RGB16, width, height);
+    FIBITMAP *rgbf = FreeImage_AllocateT(FIT_RGBF, width, height);
+    timer.restart();
+    for (int i = 0; i < rounds; i++) {
+        result = UnionImage_NameSpace::FIBitmap2QImage(rgb16);
+    }
+    RecordProperty("rgb48_kernel_ms", static_cast<int>(timer.restart()));
+    EXPECT_FALSE(result.isNull());
+    for (int i = 0; i < rounds; i++) {
+        result = UnionImage_NameSpace::FIBitmap2QImage(rgbf);
+    }
+    RecordProperty("rgbf_tonemap_ms", static_cast<int>(timer.elapsed()));
+    EXPECT_FALSE(result.isNull());
+    FreeImage_Unload(rgb16);
+    FreeImage_Unload(rgbf);
+}
+
+TEST_F(gtestview, wrapFIBitmap2QImage)
+{
+    //接管位图后的像素、行序与复制转换一致
+    FIBITMAP *dib = FreeImage_Allocate(64, 32, 32);
+    for (unsigned y = 0; y < 32; y++) {
+        BYTE *line = FreeImage_GetScanLine(dib, y);
+        for (int x = 0; x < 64 * 4; x++) {
+            line[x] = static_cast<BYTE>(x + y * 5);
+        }
+    }
+    const QImage copied = UnionImage_NameSpace::FIBitmap2QImage(dib);
+    const QImage wrapped = UnionImage_NameSpace::wrapFIBitmap2QImage(dib);
+    EXPECT_EQ(wrapped, copied);
+
+    EXPECT_TRUE(UnionImage_NameSpace::wrapFIBitmap2QImage(nullptr).isNull());
+}
+
+TEST_F(gtestview, highBitDepthDisplayFormat)
+{
+    //不带alpha的16位图显示为RGB32，只有RGBA16保留alpha
+    FIBITMAP *gray16 = FreeImage_AllocateT(FIT_UINT16, 16, 8);
+    FIBITMAP *rgb16 = FreeImage_AllocateT(FIT_RGB16, 16, 8);
+    FIBITMAP *rgba16 = FreeImage_AllocateT(FIT_RGBA16, 16, 8);
+    EXPECT_FALSE(UnionImage_NameSpace::FIBitmap2QImage(gray16).hasAlphaChannel());
+    EXPECT_FALSE(UnionImage_NameSpace::FIBitmap2QImage(rgb16).hasAlphaChannel());
+    EXPECT_EQ(UnionImage_NameSpace::toDisplayImage(UnionImage_NameSpace::FIBitmap2QImage(gray16)).format(),
+              QImage::Format_RGB32);
+    EXPECT_EQ(UnionImage_NameSpace::toDisplayImage(UnionImage_NameSpace::FIBitmap2QImage(rgb16)).format(),
+              QImage::Format_RGB32);
+    EXPECT_EQ(UnionImage_NameSpace::toDisplayImage(UnionImage_NameSpace::FIBitmap2QImage(rgba16)).format(),
+              QImage::Format_ARGB32);
+    FreeImage_Unload(gray16);
+    FreeImage_Unload(rgb16);
+    FreeImage_Unload(rgba16);
+}
+
 //TEST_F(gtestview, canSave)
 //{
 //    utils::image::freeimage::canSave(QApplication::applicationDirPath()+"/png.png");